@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "src/UHS/MiniDSP.h"
+#include "src/UHS/usbhub.h"
+#include "src/UHS/usbrecovery.h"
 #include "AmpDisplay.h"
 #include "PowerControl.h"
 #include "RemoteHandler.h"
@@ -14,6 +16,15 @@
 #include "Configuration.h"
 #include "logo.h"
 #include "InputSensing.h"
+#include "Meter.h"
+#include "EventQueue.h"
+#include "StateTable.h"
+#include "Scheduler.h"
+#include "DSPCommand.h"
+#include "Standby.h"
+#include "Probes.h"
+#include "PowerOnPlan.h"
+#include "StimulusLog.h"
 
 //#define VBUS_DEBUG
 //#define INCLUDE_DEBUG
@@ -24,6 +35,12 @@ Options & ampOptions = Options::instance();                   // singleton form
 // Hardware and interface class instances
 USB thisUSB;                                                  // USB via Host Shield
 MiniDSP ourMiniDSP(&thisUSB);                                 // MiniDSP on thisUSB
+#if MINIDSP_UNITS > 1
+USBHub usbHub(&thisUSB);                                      // Hub for the additional MiniDSP
+MiniDSP secondMiniDSP(&thisUSB);                              // Additional MiniDSP (e.g. subs)
+#endif
+MiniDSPGroup dspGroup(&ourMiniDSP);                           // All MiniDSPs; ourMiniDSP is the primary
+USBRecovery usbRecovery(&thisUSB);                            // Escalating recovery when the MiniDSP doesn't enumerate
 U8G2_SH1107_64X128_F_HW_I2C display(U8G2_R1, U8X8_PIN_NONE);  // Adafruit OLED Featherwing display on I2C bus
 AmpDisplay ampDisp(&display);                                 // Live display on the OLED
 
@@ -41,12 +58,84 @@ InputMonitor inputMonitor;
 TriggerSensing triggerMonitor;
 TimedTrigger<float> clipSensor(-defaultClippingHeadroom, clipIndicatorTime, LED_RED);  // Headroom will get set per the stored options
 
-// Interval (ms) between queries to the dsp (requests() in the main loop)
-// Limited mainly by the ~36 ms needed for refresh of the OLED display.
-constexpr uint32_t INTERVAL = 50;   
+// Interval (ms) between queries to the dsp (the requests task)
+// Independent of the display, which sends frames at its own rate (FRAME_INTERVAL in AmpDisplay.h)
+// and coalesces whatever changed in between.
+constexpr uint16_t INTERVAL = 50;   
+
+// The main loop's tasks; see setup()
+Scheduler<7> scheduler;
+uint8_t requestsTask;     // Deferred by each command to the MiniDSP
+
+#if TIMING_PROBES
+// Cycles in each poll and task, and in the handlers for each event
+CycleStats loopProbes[(uint8_t)probe_t::Count];
+CycleStats handlerProbes[(uint8_t)ampEvent_t::Count];
+#endif
 
-// Persistent state
-uint32_t lastTime {0};    // millis() of the last timed query
+#if STIMULUS_LOG
+// The inputs acted on, for replay on the host (tools/replay_host)
+StimulusLog<STIMULUS_LOG> stimulusLog;
+constexpr uint16_t triggerLogDeadband = 16;   // ADC counts a trigger sample must move by to be recorded
+#define RECORD_STIMULUS(call) stimulusLog.call
+#else
+#define RECORD_STIMULUS(call)
+#endif
+
+#if RTOS_TASKS
+// With RTOS_TASKS, loop() runs the state machine and the UI; the USB task owns the USB host and the
+// MiniDSPs, taking commands from dspCommands and posting events; the display task sends frames.
+QueueHandle_t dspCommands;
+SemaphoreHandle_t displayMutex;     // Held by loop() for each task that draws, and by the display task for each step
+
+// What loop() and the USB task share (the events, the queued commands and the DSP status) is touched
+// only with interrupts (and so task switches) held off, a few loads and stores at a time
+#define LOCK_SHARED()   taskENTER_CRITICAL()
+#define UNLOCK_SHARED() taskEXIT_CRITICAL()
+#else
+#define LOCK_SHARED()
+#define UNLOCK_SHARED()
+#endif
+
+// What loop() reads of the MiniDSPs and the host shield. With RTOS_TASKS the USB task owns them, and
+// publishes this after each command, each poll, and before each event it posts, so loop() never reads
+// the stack mid-transfer and never sees an event ahead of the state behind it. Otherwise it is read
+// straight from them.
+struct DSPStatus {
+  uint8_t vbusState;
+  uint8_t taskState;
+  int volume;                           // As MiniDSP::getVolume()
+  bool muted;
+  source_t source;
+  bool acknowledged;                    // No connected unit has a response outstanding
+  HIDUniversal::PollStats pollStats;    // The primary's
+};
+
+DSPStatus readDSPStatus() {
+  return {thisUSB.getVbusState(), thisUSB.getUsbTaskState(), ourMiniDSP.getVolume(), ourMiniDSP.isMuted(),
+          ourMiniDSP.getSource(), dspGroup.acknowledged(), ourMiniDSP.GetPollStats()};
+}
+
+#if RTOS_TASKS
+DSPStatus publishedStatus;
+
+void publishDSPStatus() {
+  DSPStatus status = readDSPStatus();
+  LOCK_SHARED();
+  publishedStatus = status;
+  UNLOCK_SHARED();
+}
+
+DSPStatus dspStatus() {
+  LOCK_SHARED();
+  DSPStatus status = publishedStatus;
+  UNLOCK_SHARED();
+  return status;
+}
+#else
+void publishDSPStatus() {}
+DSPStatus dspStatus() { return readDSPStatus(); }
+#endif
 
 // BLE services
 BLEDfu bledfu;      // Device firmware update
@@ -92,8 +181,9 @@ void OnParse(uint8_t * buf) {
 void showUSBTaskState(bool regardless = false) {
   static uint16_t lastUSBState = 0xFFFF;
   char strBuf[20];
-  uint8_t taskState = thisUSB.getUsbTaskState();
-  uint8_t vbusState = thisUSB.getVbusState();
+  DSPStatus status = dspStatus();
+  uint8_t taskState = status.taskState;
+  uint8_t vbusState = status.vbusState;
   uint16_t USBState = taskState | (vbusState << 8);
   if ((USBState != lastUSBState) || regardless) {
     snprintf(strBuf, sizeof(strBuf), "TASK %02x VBUS %02x", taskState, vbusState);
@@ -123,87 +213,289 @@ void showFrameInterval(uint32_t currentTime, uint32_t lastTime) {
     lastFrameReport = currentTime;
   }
 }
+
+// DEBUG: for showing interrupt-IN poll counters (NAKs are the wasted SPI transactions)
+void showPollStats(uint32_t currentTime) {
+  constexpr uint32_t statsReportInterval = 1000;
+  char strBuf[24];
+  static uint32_t lastStatsReport = millis();
+  static HIDUniversal::PollStats last {};
+
+  if ((currentTime - lastStatsReport) >= statsReportInterval) {
+    HIDUniversal::PollStats stats = dspStatus().pollStats;    // Counts since the last report, leaving the driver's alone
+    snprintf(strBuf, sizeof(strBuf), "P%lu R%lu N%lu T%lu", stats.polls - last.polls, stats.reports - last.reports,
+             stats.naks - last.naks, stats.timeouts - last.timeouts);
+    ampDisp.displayMessage(strBuf);
+    last = stats;
+    lastStatsReport = currentTime;
+  }
+}
+
+// DEBUG: render benchmark for the glyph cache - time of a volume redraw during a knob spin, without and with it
+void benchmarkVolumeRender() {
+  constexpr uint16_t steps = 256;
+  ampDisp.useTextCache(false);
+  uint32_t uncached = ampDisp.benchmarkVolume(steps);
+  ampDisp.useTextCache(true);
+  ampDisp.benchmarkVolume(steps);               // Fill the cache
+  uint32_t cached = ampDisp.benchmarkVolume(steps);
+  Serial.printf("Volume redraw: %lu us rasterized, %lu us from glyph cache\n", uncached, cached);
+}
+
+// DEBUG: for showing the longest main loop stall due to display refreshes, the tiles sent (8 I2C bytes each,
+// 128 in a full frame), and the pixels written by the last VU bar graph update
+void showRefreshTime(uint32_t currentTime) {
+  constexpr uint32_t refreshReportInterval = 1000;
+  char strBuf[24];
+  static uint32_t worstMicros = 0;
+  static uint8_t worstTiles = 0;
+  static uint32_t lastRefreshReport = millis();
+
+  if (ampDisp.lastRefreshMicros() > worstMicros) {
+    worstMicros = ampDisp.lastRefreshMicros();
+    worstTiles = ampDisp.lastRefreshTiles();
+  }
+
+  if ((currentTime - lastRefreshReport) >= refreshReportInterval) {
+    snprintf(strBuf, sizeof(strBuf), "%lu us %u t %u px", worstMicros, worstTiles, ampDisp.lastBarPixels());
+    ampDisp.displayMessage(strBuf, sourceArea);
+    worstMicros = 0;
+    worstTiles = 0;
+    lastRefreshReport = currentTime;
+  }
+}
 #endif
 
-constexpr float VUCoeff = 0.32 * INTERVAL / 50; // Approximates std. VU step response 90% at 300 ms
 constexpr float signalFloorDB = -128.0;
+constexpr level_t signalFloor = signalFloorDB * 256;
 
-// Filtered levels for the VU meter
-IIR<float> leftLevel(VUCoeff, signalFloorDB);
-IIR<float> rightLevel(VUCoeff, signalFloorDB);
+// Meters for the VU display: the bars, with the ballistics chosen here (VUBallistics or PPMBallistics),
+// and a peak marker for gain staging. Both assume a level sample every INTERVAL.
+typedef Meter<VUBallistics, INTERVAL> BarMeter;
+typedef Meter<PeakHoldBallistics<>, INTERVAL> PeakMeter;
+BarMeter leftLevel(signalFloor);
+BarMeter rightLevel(signalFloor);
+PeakMeter leftPeak(signalFloor);
+PeakMeter rightPeak(signalFloor);
 
 // Provide the gain corresponding to the identified source
 float sourceGain(source_t source) {
   return (source == source_t::Analog) ? (float)ampOptions.analogDigitalDifference : 0.0;
 }
 
-// On state callback for new input levels from the MiniDSP: VU meter, silence monitor, clipping sensor
-void handleInputLevels(float * levels) {
-  float left = leftLevel.next(levels[1]);
-  float right = rightLevel.next(levels[0]);
-  inputVUMeter(left, right);
-  inputMonitor.task(left, right);
-  clipSensor.next(max(left, right));
-  //digitalWrite(LED_RED, clipSensor.next(max(left, right)) ? HIGH : LOW);
+// The VU bar spans MINBARLEVEL to 0 dB, after the volume setting. barScale turns a level above the bottom
+// of the bar into percent with a multiply and shift in place of * 100 / barRange.
+constexpr level_t barRange = -MINBARLEVEL * 256;
+constexpr uint32_t barScale = (100UL << 24) / barRange + 1;
+
+// Percent of the VU bar for a meter level, given the level at the bottom of the bar
+uint8_t barPercent(level_t level, level_t bottom) {
+  return (uint32_t)limit(level - bottom, level_t(0), barRange) * barScale >> 24;
 }
 
 /**
  * @brief Provides a VU meter based on input levels and the volume setting.
  * 
- * @param levels The two inputs, in dB.
+ * @param leftLevel, rightLevel The metered inputs
+ * @param leftPeak, rightPeak Held peaks, shown as markers
  */
-void inputVUMeter(float leftLevel, float rightLevel) {
-  int intLeftLevel = round(leftLevel + ourMiniDSP.getVolumeDB());
-  int intRightLevel = round(rightLevel + ourMiniDSP.getVolumeDB());
-  uint8_t left = !ourMiniDSP.isMuted() ? max( intLeftLevel - MINBARLEVEL, 0) * 100 / -(MINBARLEVEL) : 0;
-  uint8_t right = !ourMiniDSP.isMuted() ? max( intRightLevel - MINBARLEVEL, 0) * 100 / -(MINBARLEVEL) : 0;
-  ampDisp.displayLRBarGraph(left, right, messageArea);
+void inputVUMeter(level_t leftLevel, level_t rightLevel, level_t leftPeak, level_t rightPeak) {
+  DSPStatus status = dspStatus();
+  if (status.muted) {
+    ampDisp.displayLRBarGraph(0, 0, messageArea, 0, 0);
+    return;
+  }
+  level_t bottom = (level_t)status.volume * 128 - barRange;   // Volume is in -0.5 dB steps
+  ampDisp.displayLRBarGraph(barPercent(leftLevel, bottom), barPercent(rightLevel, bottom), messageArea,
+                            barPercent(leftPeak, bottom), barPercent(rightPeak, bottom));
+}
+
+// On state callback for new input levels from the MiniDSP: VU meter, silence monitor, clipping sensor
+void handleInputLevels(float * levels) {
+  level_t leftInput = dBLevel(max(levels[1], signalFloorDB));    // The meters take no input below the floor
+  level_t rightInput = dBLevel(max(levels[0], signalFloorDB));
+  level_t left = leftLevel.next(leftInput);
+  level_t right = rightLevel.next(rightInput);
+  inputVUMeter(left, right, leftPeak.next(leftInput), rightPeak.next(rightInput));
+  inputMonitor.task(levelDB(left), levelDB(right));
+  clipSensor.next(levelDB(max(left, right)));
+  //digitalWrite(LED_RED, clipSensor.next(max(left, right)) ? HIGH : LOW);
 }
 
+// Time from the event behind a command (e.g. a knob turn) to the command going to the MiniDSP, in us
+struct CommandStats {
+  uint32_t commands;
+  uint32_t totalLatency;
+  uint32_t maxLatency;
+  uint32_t coalesced;     // Replaced the value of a set still waiting in the queue
+  uint32_t dropped;       // Command queue still full after commandQueueWait
+} commandStats {0, 0, 0, 0, 0};
+
+uint32_t causeTime {0};   // micros() when the event being dispatched was posted; 0 outside dispatch
+
+// Carry out a command: in the USB task with RTOS_TASKS, otherwise at once
+void runCommand(const DSPCommand & command) {
+  PROBE(Commands);
+  switch (command.type) {
+    case dspCommand_t::SetVolume:           dspGroup.setVolume(command.value); break;
+    case dspCommand_t::SetMute:             dspGroup.setMute(command.flag); break;
+    case dspCommand_t::SetSource:           dspGroup.setSource(command.source); break;
+    case dspCommand_t::SetInputGain:        dspGroup.setInputGain(command.gain); break;
+    case dspCommand_t::SetPreset:           dspGroup.setPreset(command.value, true); break;
+    case dspCommand_t::RequestVolume:       ourMiniDSP.requestVolume(); break;
+    case dspCommand_t::RequestMute:         ourMiniDSP.requestMute(); break;
+    case dspCommand_t::RequestSource:       ourMiniDSP.requestSource(); break;
+    case dspCommand_t::RequestPreset:       ourMiniDSP.requestPreset(); break;
+    case dspCommand_t::RequestInputLevels:  ourMiniDSP.RequestInputLevels(); break;
+    case dspCommand_t::RequestStatus:       ourMiniDSP.RequestStatus(); break;
+    case dspCommand_t::ResetUSB:
+      thisUSB.Task();
+      if (thisUSB.getVbusState() != SE0) {
+        thisUSB.Init();
+        thisUSB.busprobe(true);
+      }
+      break;
+    case dspCommand_t::StartRecovery:       usbRecovery.start(); break;
+    case dspCommand_t::RestartUSB:
+      thisUSB.Init();
+      thisUSB.busprobe(true);
+      break;
+    case dspCommand_t::PowerDownUSB:        thisUSB.powerDown(); break;
+  }
+  if (command.type <= dspCommand_t::SetPreset) {
+    uint32_t latency = micros() - command.time;
+    commandStats.commands++;
+    commandStats.totalLatency += latency;
+    commandStats.maxLatency = max(commandStats.maxLatency, latency);
+  }
+}
+
+#if RTOS_TASKS
+// Commands queued for the USB task are numbered. Until the USB task has taken the last one queued, a
+// set of the same kind replaces its value rather than queuing another: a knob spin during a long
+// transfer sends only the latest volume, and can't fill the queue. Sets of other kinds keep their order.
+constexpr uint32_t commandQueueWait = 10;   // ms to wait for room when the queue is full of other commands
+uint16_t lastQueued {0};                    // Number of the last command queued (loop() only)
+dspCommand_t lastQueuedType;
+uint16_t lastTaken {0};                     // Number of the last command the USB task has taken (shared)
+uint16_t lastDone {0};                      // ... and has carried out (shared)
+DSPCommand replacement;                     // New value for command replacement.seq, while replacing (shared)
+bool replacing {false};
+
+// Whether commands are queued or being carried out
+bool commandsPending() {
+  LOCK_SHARED();
+  bool pending = lastDone != lastQueued;
+  UNLOCK_SHARED();
+  return pending;
+}
+
+// In the USB task: take the next command, with its latest value
+bool takeCommand(DSPCommand & command) {
+  if (xQueueReceive(dspCommands, &command, 0) != pdTRUE) return false;
+  LOCK_SHARED();
+  lastTaken = command.seq;
+  if (replacing && replacement.seq == command.seq) {
+    command = replacement;
+    replacing = false;
+  }
+  UNLOCK_SHARED();
+  return true;
+}
+#endif
+
+void dspCommand(DSPCommand command) {
+  command.time = causeTime ? causeTime : micros();
+  #if RTOS_TASKS
+  if (command.type <= dspCommand_t::SetPreset && command.type == lastQueuedType) {
+    LOCK_SHARED();
+    bool waiting = lastTaken != lastQueued;
+    if (waiting) {
+      command.seq = lastQueued;
+      replacement = command;
+      replacing = true;
+    }
+    UNLOCK_SHARED();
+    if (waiting) {
+      commandStats.coalesced++;
+      return;
+    }
+  }
+  command.seq = lastQueued + 1;
+  if (xQueueSend(dspCommands, &command, ms2tick(commandQueueWait)) != pdTRUE) {
+    commandStats.dropped++;
+    return;
+  }
+  lastQueued = command.seq;
+  lastQueuedType = command.type;
+  #else
+  runCommand(command);
+  #endif
+}
+
+void dspCommand(dspCommand_t type) { DSPCommand c; c.type = type; dspCommand(c); }
+void dspCommand(dspCommand_t type, uint8_t value) { DSPCommand c; c.type = type; c.value = value; dspCommand(c); }
+void dspCommand(dspCommand_t type, bool flag) { DSPCommand c; c.type = type; c.flag = flag; dspCommand(c); }
+void dspCommand(dspCommand_t type, source_t source) { DSPCommand c; c.type = type; c.source = source; dspCommand(c); }
+void dspCommand(dspCommand_t type, float gain) { DSPCommand c; c.type = type; c.gain = gain; dspCommand(c); }
+
+// Poll the USB host, unless the USB task does
+void usbPoll() {
+  #if !RTOS_TASKS
+  PROBE(USB);
+  thisUSB.Task();
+  #endif
+}
+
+// Poll the inputs
+void remotePoll() { PROBE(Remote); ourRemote.Task(); }
+void knobPoll() { PROBE(Knob); knob.task(); }
+void buttonPoll() { PROBE(Button); RECORD_STIMULUS(button(goButton.rawClosed())); goButton.Task(); }
+
 // Set the volume in the MiniDSP, respecting limits
 void setVolume(uint8_t volume) {
-  ourMiniDSP.setVolume(limit(volume, ampOptions.maxVolume, uint8_t(0xFF)));   // Unsigned int representing negative dB, so min is maxVolume
-  lastTime = millis();
+  dspCommand(dspCommand_t::SetVolume, limit(volume, ampOptions.maxVolume, uint8_t(0xFF)));   // Unsigned int representing negative dB, so min is maxVolume
+  scheduler.defer(requestsTask);
 }
 
 // Change volume by the specified amount
 void volChange(int8_t change) {
-  int currentVolume = ourMiniDSP.getVolume();
+  int currentVolume = dspStatus().volume;
   int newVolume = currentVolume - change;     // + change is - change in the MiniDSP setting
   newVolume = limit(newVolume, int(ampOptions.maxVolume), 0xFF); //min( max(newVolume, ampOptions.maxVolume), 0xFF);
-  if (newVolume != currentVolume) ourMiniDSP.setVolume(static_cast<uint8_t>(newVolume));
-  if (ourMiniDSP.isMuted()) ourMiniDSP.setMute(false);
+  if (newVolume != currentVolume) dspCommand(dspCommand_t::SetVolume, static_cast<uint8_t>(newVolume));
+  if (dspStatus().muted) dspCommand(dspCommand_t::SetMute, false);
   ampDisp.wakeup();
-  lastTime = millis();
+  scheduler.defer(requestsTask);
 }
 
 // Increase the volume by one tick
 void volPlus() {
-  uint8_t currentVolume = static_cast<uint8_t>(ourMiniDSP.getVolume());
-  if (currentVolume > ampOptions.maxVolume) ourMiniDSP.setVolume(--currentVolume);
-  if (ourMiniDSP.isMuted()) ourMiniDSP.setMute(false);
+  uint8_t currentVolume = static_cast<uint8_t>(dspStatus().volume);
+  if (currentVolume > ampOptions.maxVolume) dspCommand(dspCommand_t::SetVolume, --currentVolume);
+  if (dspStatus().muted) dspCommand(dspCommand_t::SetMute, false);
   ampDisp.wakeup();   // Only really needed if already at maximum
-  lastTime = millis();
+  scheduler.defer(requestsTask);
 }
 
 // Decrease the volume by one tick
 void volMinus() {
-  uint8_t currentVolume = static_cast<uint8_t>(ourMiniDSP.getVolume());
-  if (currentVolume != 0xFF) ourMiniDSP.setVolume(++currentVolume);
-  if (ourMiniDSP.isMuted()) ourMiniDSP.setMute(false);
-  lastTime = millis();
+  uint8_t currentVolume = static_cast<uint8_t>(dspStatus().volume);
+  if (currentVolume != 0xFF) dspCommand(dspCommand_t::SetVolume, ++currentVolume);
+  if (dspStatus().muted) dspCommand(dspCommand_t::SetMute, false);
+  scheduler.defer(requestsTask);
 }
 
 // Set the mute in the MiniDSP
 void setMute(bool muted) {
-  ourMiniDSP.setMute(muted);
-  lastTime = millis();
+  dspCommand(dspCommand_t::SetMute, muted);
+  scheduler.defer(requestsTask);
 }
 
 // Toggle the mute state
 void toggleMute() {
-  ourMiniDSP.setMute(!ourMiniDSP.isMuted());
-  lastTime = millis();
+  dspCommand(dspCommand_t::SetMute, !dspStatus().muted);
+  scheduler.defer(requestsTask);
   //static bool m {false};
   //m = !m;
   //if (m) powerControl.ampDisable(); else powerControl.ampEnable();
@@ -211,13 +503,13 @@ void toggleMute() {
 
 // Set the source in the MiniDSP
 void setSource(source_t source) {
-  ourMiniDSP.setSource(source);
+  dspCommand(dspCommand_t::SetSource, source);
   //ourMiniDSP.setVolumeOffset(source == source_t::Analog ? 0 : ampOptions.analogDigitalDifference);
-  lastTime = millis();
+  scheduler.defer(requestsTask);
 }
 // Identify the currently unselected
 source_t flipSource() {
-  source_t newSource = ourMiniDSP.getSource() == source_t::Analog ? source_t::Toslink : source_t::Analog;
+  source_t newSource = dspStatus().source == source_t::Analog ? source_t::Toslink : source_t::Analog;
   return newSource;
 }
 
@@ -226,8 +518,8 @@ void setInputGain(source_t source) {
   //const float aGains[] = {6.0, 6.0};
   //const float dGains[] = {-40.0, 0.0};
   //if (source == source_t::Toslink) ourMiniDSP.setInputGains(dGains);
-  ourMiniDSP.setInputGain(sourceGain(source));
-  lastTime = millis();
+  dspCommand(dspCommand_t::SetInputGain, sourceGain(source));
+  scheduler.defer(requestsTask);
 }
 
 // Show the preset, using the volume area
@@ -244,17 +536,29 @@ void optionsSetup() {
 }
 
 void showLogo(bool version = false) {
-  display.clear();
+  ampDisp.drawFrame();
   display.drawXBMP(0, (64 - logo_height) / 2, logo_width, logo_height, logo_bits);
   if (version) ampDisp.displayMessage(VERSION);
-  display.updateDisplay();
+  ampDisp.refresh();
 }
 
+// The logo and version stay up for logoTime after setup, while the Off state carries on behind them
+constexpr uint32_t logoTime = 2000;   // ms
+uint32_t logoUntil {0};               // millis()
+
+// millis() at which the Off state first took input: boot to ready
+uint32_t readyTime {0};
+
+// Times the phases of each power-on, and keeps what the MiniDSP has said since it enumerated
+PowerOnPlan powerOnPlan;
+
 // The main state machine - uses a classic state pattern.
 // Each state has 
 //   entry(), invoked when switching to the state 
+//   exit(), invoked when leaving it,
 //   poll(), invoked each time around the loop,
-//   request(), invoked on each 50 ms tick, and
+//   request(), invoked on each 50 ms tick,
+//   idle(), invoked after each pass, to sleep if the state allows, and
 //   a callback for each possible event. 
 // Naming convention for callbacks is on<Source><Event>(...)
 
@@ -262,10 +566,14 @@ void showLogo(bool version = false) {
 class AmpState {
   public:
     virtual void onEntry(){}
+    virtual void onExit(){}
     virtual void polls(){}
     virtual void requests(){}
+    virtual bool idle(uint32_t ms){ return false; }   // After each pass: may sleep for up to ms. Returns true if it slept.
 
     virtual void onDSPConnected(){}
+    virtual void onDSPTimeout(){}
+    virtual void onDSPLost(){}
     virtual void onDSPVolume(uint8_t volume){}
     virtual void onDSPMute(bool mute){}
     virtual void onDSPSource(source_t source){}
@@ -290,8 +598,12 @@ class AmpState {
     virtual void onMenuExit(){}
 };
 
-// Transition to the identified state
-void transitionTo(AmpState * newState);
+// Leave the current state for the given one
+void enterState(ampStateId_t to, ampTrigger_t trigger);
+
+// Post the volume or mute as if the MiniDSP had just reported it, for a state that already knows it
+void postDSPVolume(uint8_t volume);
+void postDSPMute(bool mute);
 
 #ifdef VBUS_DEBUG
 // VBUS_DEBUG code for automatically doing N power cycles
@@ -303,31 +615,80 @@ int powerCycles {0};
 
 void showDebugData() {
   Serial.printf("N %d E %d I %d P %d\n", cycleCount, offStateExtras, initCount, powerCycles);
+  usbRecovery.printStats(Serial);
   // char buf[30];
   // snprintf(buf, 25, "N %d E %d I %d P %d", cycleCount, offStateExtras, initCount, powerCycles);
   // ampDisp.displayMessage(buf);
   // ampDisp.refresh();
 }
+
+#if ENABLE_UHS_EVENT_TRACE
+// Freeze the USB event trace at a failure and save it, for decoding with tools/usbtrace_decode.py
+void dumpUSBTrace() {
+  constexpr char tracePath[] = "/usbtrace.bin";
+  UsbTraceFreeze();
+  UsbTraceDump(Serial, true);
+  Adafruit_LittleFS_Namespace::File traceFile(InternalFS);
+  if (InternalFS.exists(tracePath)) InternalFS.remove(tracePath);
+  if (traceFile.open(tracePath, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+    UsbTraceDump(traceFile);
+    traceFile.close();
+  }
+  UsbTraceClear();
+  UsbTraceFreeze(false);
+}
+#endif
 // 
 #endif
 
-// The Off state - power down, then just watch the remote, button, and triggers
+// The Off state - power down, then just watch the remote, button, and triggers.
+// Once the MiniDSP has gone, stand by: host shield and display powered down, and the CPU asleep
+// between trigger samples unless the button or the remote is in use.
 const uint32_t minOffTime = 1000;
 class AmpOffState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::Off};
   uint32_t entryTime {0};
+  bool settled {false};     // minOffTime has passed
+  bool framed {false};      // The frame has replaced the start-up logo
+  Standby & standby = Standby::instance();
+
+  void enterStandby() {
+    dspCommand(dspCommand_t::PowerDownUSB);
+    display.setPowerSave(1);
+    standby.enter();
+  }
+
+  void onExit() override {
+    if (!standby.active()) return;
+    standby.exit();
+    display.setPowerSave(0);
+    dspCommand(dspCommand_t::RestartUSB);   // Restarts the oscillator
+  }
+
+  bool idle(uint32_t ms) override {
+    if (!standby.active() || !goButton.idle() || ourRemote.receiving()) return false;
+    standby.sleep(ms);
+    return true;
+  }
   void onEntry() override {
     entryTime = millis();
+    settled = false;
+    framed = false;
+    powerOnPlan.abandon();
     powerControl.ampDisable();
     powerControl.powerOff();
-    display.clear();
-    display.updateDisplay();
     ourRemote.stopListening(); // Empty the receive buffer
     ourRemote.listen();
   }
   void polls() override {
-    if (thisUSB.getVbusState() != SE0) thisUSB.Task();  // After powerOff, continue polling the USB until we see the disconnect
+    if (dspStatus().vbusState != SE0) usbPoll();       // After powerOff, continue polling the USB until we see the disconnect
     //thisUSB.Task();
     uint32_t currentTime = millis();
+    if (!framed && (int32_t)(currentTime - logoUntil) >= 0) {
+      ampDisp.drawFrame();
+      ampDisp.refresh();
+      framed = true;
+    }
     if ((currentTime - entryTime) > minOffTime) {       // Avoid re-applying power too soon
       // if (thisUSB.getVbusState() != SE0) {
       //   thisUSB.busprobe(true);  // Just in case the chip missed the disconnect - This appears never to be reached
@@ -335,9 +696,11 @@ class AmpOffState : public AmpState {
       //   offStateExtras++;
       //   #endif
       // }
-      ourRemote.Task();
-      goButton.Task();
-      triggerMonitor.task();
+      remotePoll();
+      buttonPoll();
+      settled = true;
+      if (!readyTime) readyTime = currentTime;
+      if (framed && !standby.active() && dspStatus().vbusState == SE0) enterStandby();
       entryTime = currentTime + minOffTime;         // Keep working 45 days later!
       #ifdef VBUS_DEBUG
       showDebugData();
@@ -348,99 +711,119 @@ class AmpOffState : public AmpState {
       #endif
     }
   }
-  void onButtonFullHold() override;                 // --> Menu - See the transition table
-  void onButtonShortPress() override;               // --> Start seq - See transition table
+  void onButtonFullHold() override { fire<id, ampTrigger_t::ButtonFullHold>(); }
+  void onButtonShortPress() override { fire<id, ampTrigger_t::ButtonShortPress>(); }
 
-  void onTriggerRise(trigger_t sources) override;   // --> Start seq - See transition table
+  void onTriggerRise(trigger_t sources) override { if (settled) fire<id, ampTrigger_t::TriggerRise>(); }
 
-  void onRemotePower() override;                    // --> Start seq - See transition table below
+  void onRemotePower() override { fire<id, ampTrigger_t::RemotePower>(); }
 } ampOffState;
 
-// Menu state
+// Menu state - the menu starts once the button that brought it up has been released
 class AmpMenuState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::Menu};
+  bool started {false};
   void onEntry() override {
+    started = false;
     ampDisp.displayMessage("Settings...", sourceArea);
-    ampDisp.refresh();
-    while (goButton.switchClosed()) delay(100);
+    ampDisp.flush();          // The menu draws to the display directly
+  }
+
+  void start() {
     ampDisp.displayMessage("", sourceArea);
     display.setFontPosBottom();   // The ArduinoMenu library expects this.
     OptionsMenu::reset();
     OptionsMenu::begin();
+    started = true;
   }
 
   void polls() {
-    knob.task();
-    goButton.Task();
+    knobPoll();
+    buttonPoll();
+    if (!started) {
+      if (goButton.idle()) start();
+      return;
+    }
+    PROBE(Menu);
     OptionsMenu::task();
   }
   
   void onKnobTurned(int8_t change) override {
-    if (!change) return;
+    if (!change || !started) return;
     if (change > 0) OptionsMenu::cursorUp(); else OptionsMenu::cursorDown(); 
   }
 
-  void onButtonShortPress() override { OptionsMenu::enter(); }
-  void onMenuExit() override;                       // --> Off - See the transition table
+  void onButtonShortPress() override { if (started) OptionsMenu::enter(); }
+  void onMenuExit() override { fire<id, ampTrigger_t::MenuExit>(); }
 } ampMenuState;
 
 // DSP wait state - power up and watch for the DSP to become connected.
-const uint32_t maxDSPStartupTime = 10000; // ms. Normal MiniDSP startup is about 6 seconds
+// If it doesn't, usbRecovery works through bus reset, chip reset and VBUS toggle before asking for a power cycle.
+// Entry from Off is the edge that the power-on is timed from; the relay closes first, since the MiniDSP's boot is the long pole.
 class AmpWaitDSPState : public AmpState {
-  uint32_t entryTime {0};
+  static constexpr ampStateId_t id {ampStateId_t::WaitDSP};
   void onEntry() override {
+    if (!powerOnPlan.active()) powerOnPlan.start(causeTime ? causeTime : micros());   // Not after a power cycle
+    powerControl.ampDisable();
+    powerControl.powerOn();
+    powerOnPlan.reached(powerOnPhase_t::RelayOn);
     showLogo();
     #ifdef VBUS_DEBUG
     showDebugData();
     #endif
-    entryTime = millis();
-    thisUSB.Task();                       // Just in case we enter this state from other than AmpOff
-    if (thisUSB.getVbusState() != SE0) {  // This should have been satisfied while in AmpOff - and it appears that it reliably is
+    dspCommand(dspCommand_t::ResetUSB);   // Just in case we enter this state from other than AmpOff
+    if (dspStatus().vbusState != SE0) {  // This should have been satisfied while in AmpOff - and it appears that it reliably is
       //showUSBTaskState(true);
       #ifdef VBUS_DEBUG
       initCount++;
       #endif
-      thisUSB.Init();
-      thisUSB.busprobe(true);
       ampDisp.displayMessage("0");
     } else {
       ampDisp.displayMessage(".");
     }
-    powerControl.ampDisable();
-    powerControl.powerOn();
     ampDisp.refresh();
     ampDisp.undim();
+    dspCommand(dspCommand_t::StartRecovery);
   }
 
-  void onDSPTimeout();                              // --> Cycle power - See transition table
+  void onDSPTimeout() override { fire<id, ampTrigger_t::DSPTimeout>(); }
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
     //showUSBTaskState();
-    if ((millis() - entryTime) > maxDSPStartupTime) onDSPTimeout();
+    #if !RTOS_TASKS
+    PROBE(Recovery);
+    usbRecovery.Task();                               // Calls onDSPTimeout() when only a power cycle is left
+    #endif
+  }
+  void onDSPConnected() override {
+    powerOnPlan.reached(powerOnPhase_t::Enumerated);
+    fire<id, ampTrigger_t::DSPConnected>();
   }
-  void onDSPConnected() override;                   // --> Source check - See transition table
 } ampWaitDSPState;
 
 // DSP timeout state - power down for 2 sec and retry
 const uint32_t DSPPowerDownTime = 2000; // ms
 class AmpCyclePowerState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::CyclePower};
   uint32_t entryTime {0};
   void onEntry() override {
     entryTime = millis();
     powerControl.powerOff();
     #ifdef VBUS_DEBUG
     powerCycles++;
-    Serial.printf("Timeout on cycle %d with Task state %02X and Vbus state %02X\n", cycleCount, thisUSB.getUsbTaskState(), thisUSB.getVbusState());
+    Serial.printf("Timeout on cycle %d with Task state %02X and Vbus state %02X\n", cycleCount, dspStatus().taskState, dspStatus().vbusState);
+    #if ENABLE_UHS_EVENT_TRACE
+    dumpUSBTrace();
+    #endif
     #endif
     ampDisp.displayMessage("*");
     ampDisp.refresh();
   }
-  void onTime();                                    // --> Wait for DSP - see transition table
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
     if ((millis() - entryTime) > DSPPowerDownTime) {
-      thisUSB.Init();  
-      thisUSB.busprobe(true);
-      onTime();
+      dspCommand(dspCommand_t::RestartUSB);
+      fire<id, ampTrigger_t::PowerCycled>();
     }
   }
 } ampCylcePowerState;
@@ -449,6 +832,7 @@ class AmpCyclePowerState : public AmpState {
 // or if entered via the button or remote, just switch inputs regardless of the triggers
 class AmpWaitSourceState : public AmpState {
   private:
+    static constexpr ampStateId_t id {ampStateId_t::WaitSource};
     source_t desiredSource {source_t::Unset};
 
   public:
@@ -458,15 +842,19 @@ class AmpWaitSourceState : public AmpState {
     ampDisp.displayMessage(".."); 
     ampDisp.refresh();
     if (desiredSource != source_t::Unset) setSource(desiredSource);
+    else scheduler.expedite(requestsTask);
     }
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
   }
   void requests() override {
-    ourMiniDSP.requestSource(); 
+    dspCommand(dspCommand_t::RequestStatus);    // The volume and mute come too, for the states after
   }
 
-  void toSetGain();
+  void toSetGain() {
+    powerOnPlan.reached(powerOnPhase_t::SourceSet);
+    fire<id, ampTrigger_t::SourceSet>();
+  }
   void onDSPSource(source_t source) override {
     // If a desired source is set, check input against that
     if (desiredSource != source_t::Unset) {
@@ -498,20 +886,24 @@ class AmpWaitSourceState : public AmpState {
 
 // Set gain state - ensure that input gains match the options settings
 class AmpSetGainState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::SetGain};
   void onEntry() override { 
     ampDisp.displayMessage("..."); 
     ampDisp.refresh();
+    scheduler.expedite(requestsTask);
     }
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
   }
   void requests() override {
-    setInputGain(ourMiniDSP.getSource());
+    setInputGain(dspStatus().source);
   }
-  void toWaitVolume();
   void onDSPInputGains(float * gains) {
-    float reqGain = sourceGain(ourMiniDSP.getSource());
-    if (fEqual(gains[1], reqGain) && fEqual(gains[1], reqGain)) toWaitVolume();   
+    float reqGain = sourceGain(dspStatus().source);
+    if (fEqual(gains[1], reqGain) && fEqual(gains[1], reqGain)) {
+      powerOnPlan.reached(powerOnPhase_t::GainSet);
+      fire<id, ampTrigger_t::GainSet>();
+    }
   }
 } ampSetGainState;
 
@@ -519,81 +911,97 @@ class AmpSetGainState : public AmpState {
 // Placing this in the sequence after the source change means that the startup volume limit applies
 // whenever the source is changed.
 class AmpWaitVolumeState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::WaitVolume};
   void onEntry() override { 
     ampDisp.displayMessage("...."); 
     ampDisp.refresh();
+    if (powerOnPlan.volumeKnown()) postDSPVolume(powerOnPlan.volume()); // From the status read, next pass
+    else scheduler.expedite(requestsTask);
     }
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
   }
   void requests() override {
-    ourMiniDSP.requestVolume(); 
+    dspCommand(dspCommand_t::RequestVolume);
   }
-  void toWaitMute();
-  
   void onDSPVolume(uint8_t volume) override {
     if (volume < ampOptions.maxInitialVolume) setVolume(ampOptions.maxInitialVolume);
-    else toWaitMute();                              // --> Mute check - See transition table
+    else {
+      powerOnPlan.reached(powerOnPhase_t::VolumeSet);
+      fire<id, ampTrigger_t::VolumeSet>();
+    }
   }
 } ampWaitVolumeState;
 
 // Mute wait state - ensure that the DSP is unmuted
 class AmpWaitMuteState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::WaitMute};
   void onEntry() override { 
     ampDisp.displayMessage("....."); 
     ampDisp.refresh();
+    if (powerOnPlan.muteKnown()) postDSPMute(powerOnPlan.muted());      // From the status read, next pass
+    else scheduler.expedite(requestsTask);
     }
     //setMute(false); }
   void polls() override {
-    thisUSB.Task();
+    usbPoll();
   }
   void requests() override { 
-    ourMiniDSP.requestMute(); // Could be requestMute();
+    dspCommand(dspCommand_t::RequestMute);
   }
-  void toOn();
   void onDSPMute(bool isMuted) override {
     if (isMuted) setMute(false);
-    else toOn();                                    // --> On - See transition table
+    else {
+      powerOnPlan.reached(powerOnPhase_t::Unmuted);
+      fire<id, ampTrigger_t::Unmuted>();
+    }
   }
 } ampWaitMuteState;
 
-// The ON state: respond to the remote, knob, button, and triggers, and maintain the display
+// The ON state: respond to the remote, knob, button, and triggers, and maintain the display.
+// When the input goes, go to warm standby (or, with no warm standby time, straight to Off).
 class AmpOnState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::On};
   void onEntry() override {
     RotaryEncoder.read();     // ensure that the change count is zero.
     powerControl.ampEnable();
     inputMonitor.setTimout(ampOptions.autoOffTime);
     inputMonitor.resetTimer();
     clipSensor.setThreshold(-(float)ampOptions.clippingHeadroom);
-    display.clear();
-    ampDisp.source((source_t) ourMiniDSP.getSource());
-    ampDisp.volume(-ourMiniDSP.getVolume()/2.0);
-    ampDisp.mute(ourMiniDSP.isMuted());
+    ampDisp.drawFrame();
+    ampDisp.setAutoDim(true);
+    DSPStatus status = dspStatus();
+    ampDisp.source(status.source);
+    ampDisp.volume(status.volume);
+    ampDisp.mute(status.muted);
     ourRemote.stopListening();  // Empty the receive buffer
     ourRemote.listen();
   }
+  void onExit() override {
+    ampDisp.setAutoDim(false);    // Only the On state dims, and the menu sets the contrast itself
+  }
   void polls() override {
-    thisUSB.Task();
-    ourRemote.Task();
-    knob.task();
-    goButton.Task();
-    triggerMonitor.task();
-    ampDisp.checkDim();
+    usbPoll();
+    remotePoll();
+    knobPoll();
+    buttonPoll();
+    if (powerOnPlan.active() && powerControl.settled()) powerOnPlan.reached(powerOnPhase_t::AmpsEnabled);
     ampDisp.refresh();
     #ifdef VBUS_DEBUG
-    transitionTo(&ampOffState);
+    fire<id, ampTrigger_t::TestCycle>();
     #endif
   };
 
-  void requests() override { ourMiniDSP.RequestInputLevels(); }
+  void requests() override { dspCommand(dspCommand_t::RequestInputLevels); }
 
-  void onDSPVolume(uint8_t volume) override { ampDisp.volume(-volume/2.0); }
+  void onDSPVolume(uint8_t volume) override { ampDisp.volume(volume); }
   void onDSPMute(bool isMuted) { ampDisp.mute(isMuted); }
   void onDSPSource(source_t source) { ampDisp.source((source_t) source); }
   void onDSPInputLevels(float * levels) { handleInputLevels(levels); }
+  void onDSPLost() override { fire<id, ampTrigger_t::DSPLost>(); }     // Amps off, and wait for every unit again
 
-  void toOff();
-  void toSource();
+  void toOff() { fire<id, ampTrigger_t::InputGone>(); }
+  void toSource() { fire<id, ampTrigger_t::SourceChange>(); }
 
   void onButtonShortPress() override { toggleMute(); }
   void onButtonLongPressPending() override { ampDisp.cueLongPress(); }
@@ -601,7 +1009,7 @@ class AmpOnState : public AmpState {
     ampWaitSourceState.setDesiredSource(flipSource());
     toSource();
   }
-  void onButtonFullHold() override;                         // --> Off - See transition table
+  void onButtonFullHold() override { fire<id, ampTrigger_t::ButtonFullHold>(); }
 
   void onRemoteVolPlus() override { volPlus(); }
   void onRemoteVolMinus() override { volMinus(); }
@@ -610,34 +1018,34 @@ class AmpOnState : public AmpState {
     ampWaitSourceState.setDesiredSource(flipSource());
     toSource();
   }
-  void onRemotePreset() override;                           // --> Choose preset - See transition table
-  void onRemotePower() override;                            // --> Off - See transition table
+  void onRemotePreset() override { fire<id, ampTrigger_t::RemotePreset>(); }
+  void onRemotePower() override { fire<id, ampTrigger_t::RemotePower>(); }
 
   void onKnobTurned(int8_t change) override { volChange(change); }
 
   void onTriggerFall(trigger_t triggers) override {
     // triggers indicates which has fallen
-    source_t source = ourMiniDSP.getSource();
+    source_t source = dspStatus().source;
     if (triggers.analog && (source == source_t::Analog)) {
       if (!triggerMonitor.getTriggers().digital) {
         clipSensor.clearIndicator();
-        toOff();                                            // --> Off - see transition table
+        toOff();
         return;
       }
-      toSource();                                           // --> Switch source - see transition table
+      toSource();
     }
     if (triggers.digital && (source == source_t::Toslink)) {
       if (!triggerMonitor.getTriggers().analog) {
         clipSensor.clearIndicator();
-        toOff();                                            // --> Off - see transition table
+        toOff();
         return;
       }
-      toSource();                                           // --> Switch source - see transition table
+      toSource();
     }
   }
 
   void onSilence() override {
-    if (ourMiniDSP.getSource() == source_t::Analog) {
+    if (dspStatus().source == source_t::Analog) {
       if (triggerMonitor.getTriggers().analog) return;  // Ignore silence when trigger present
       if (silenceSourceChange && triggerMonitor.getTriggers().digital) {
         toSource();                                     // Silence with other trigger present
@@ -660,11 +1068,67 @@ class AmpOnState : public AmpState {
 
 } ampOnState;
 
+// Warm standby state - after the input goes, mute and disable the amps but keep the MiniDSP powered and
+// enumerated, so that the input coming back needs only the unmute and amp enable (WaitMute, then On).
+// The loop sleeps between trigger samples as in Off. After the warm standby time, turn off.
+class AmpWarmStandbyState : public AmpState {
+  static constexpr ampStateId_t id {ampStateId_t::WarmStandby};
+  uint32_t entryTime {0};
+  Standby & standby = Standby::instance();
+
+  void onEntry() override {
+    entryTime = millis();
+    powerControl.ampDisable();
+    setMute(true);
+    ampDisp.displayMessage("Standby");
+    ampDisp.refresh();
+    ampDisp.dim();
+    ourRemote.stopListening();  // Empty the receive buffer
+    ourRemote.listen();
+    standby.enter();
+  }
+  void onExit() override {
+    standby.exit();
+    ampDisp.undim();
+  }
+  bool idle(uint32_t ms) override {
+    if (!goButton.idle() || ourRemote.receiving()) return false;
+    standby.sleep(ms);
+    return true;
+  }
+  void polls() override {
+    usbPoll();
+    remotePoll();
+    buttonPoll();
+    if ((millis() - entryTime) > ampOptions.warmStandbyTime * 60000UL) fire<id, ampTrigger_t::WarmTimeout>();
+  }
+
+  void onDSPLost() override { fire<id, ampTrigger_t::WarmTimeout>(); }
+
+  void resume() { fire<id, ampTrigger_t::Resume>(); }
+
+  void onButtonShortPress() override { resume(); }
+  void onButtonFullHold() override { fire<id, ampTrigger_t::ButtonFullHold>(); }
+  void onRemotePower() override { resume(); }
+
+  void onTriggerRise(trigger_t triggers) override {
+    // triggers indicates which has risen. The other input's needs the source set first.
+    source_t source = dspStatus().source;
+    if ((triggers.analog && source == source_t::Analog) || (triggers.digital && source == source_t::Toslink)) {
+      resume();
+      return;
+    }
+    ampWaitSourceState.setDesiredSource(source_t::Unset);     // Per the triggers
+    fire<id, ampTrigger_t::SourceChange>();
+  }
+} ampWarmStandbyState;
+
 // Set preset state - set the new preset
 const uint32_t SET_PRESET_TIMEOUT {4000};   // ms. Normal response is about 2 seconds
 class AmpSetPreState : public AmpState {
 
   private:
+    static constexpr ampStateId_t id {ampStateId_t::SetPreset};
     uint8_t newPreset {4};
     uint32_t setTime {0};
 
@@ -674,28 +1138,28 @@ class AmpSetPreState : public AmpState {
     }
 
   private:
-    void toOn();
     void onEntry() override {
       setTime = millis();
-      if (newPreset > 3) toOn();
-      else ourMiniDSP.setPreset(newPreset, true);
+      if (newPreset > 3) fire<id, ampTrigger_t::PresetSet>();
+      else dspCommand(dspCommand_t::SetPreset, newPreset);
     }
 
     void polls() override {
-      thisUSB.Task();
+      usbPoll();
       if ((millis() - setTime) > SET_PRESET_TIMEOUT) {
         setTime = millis();
-        ourMiniDSP.setPreset(newPreset, true);
+        dspCommand(dspCommand_t::SetPreset, newPreset);
       }
     }
 
-    void onDSPPreset(uint8_t preset) override;      // --> ampOnState - see transition table
+    void onDSPPreset(uint8_t preset) override { fire<id, ampTrigger_t::PresetSet>(); }
 
 } ampSetPreState;
 
 // Choose preset state - display the current preset and increment with each remote press. 
 class AmpChoosePreState : public AmpState {
 
+  static constexpr ampStateId_t id {ampStateId_t::ChoosePreset};
   uint8_t currentPreset {4};  // Presets are 0..3
   uint8_t newPreset {4};
   uint32_t lastTime {0};
@@ -708,24 +1172,17 @@ class AmpChoosePreState : public AmpState {
     ampDisp.refresh();
   }
 
-  void toSetPreset();
-  void toOn();
   void polls() override {
-    thisUSB.Task();
-    ourRemote.Task();
+    usbPoll();
+    remotePoll();
     if ((millis() - lastTime) > CHOOSE_PRESET_TIMEOUT) {
-      if (newPreset != currentPreset) {
-        ampSetPreState.setDesiredPreset(newPreset);
-        toSetPreset();
-      }
-      else {
-        toOn();
-      }
+      ampSetPreState.setDesiredPreset(newPreset);
+      fire<id, ampTrigger_t::PresetTimeout>();      // --> SetPreset if presetChanged(), else On
     }
   }
 
   void requests() override {
-    if (currentPreset > 3) ourMiniDSP.requestPreset();
+    if (currentPreset > 3) dspCommand(dspCommand_t::RequestPreset);
   }
 
   void onDSPPreset(uint8_t preset) {
@@ -741,93 +1198,367 @@ class AmpChoosePreState : public AmpState {
     lastTime = millis();
   }
 
+  public:
+    bool changed() const { return newPreset != currentPreset; }
+
 } ampChoosePreState;
 
 
 
-// State transitions
-void AmpOffState::        onRemotePower()           { transitionTo(&ampWaitDSPState); }
-void AmpOffState::        onButtonShortPress()      { transitionTo(&ampWaitDSPState); }
-void AmpOffState::        onButtonFullHold()        { transitionTo(&ampMenuState);    }
-void AmpOffState::        onTriggerRise(trigger_t)  { transitionTo(&ampWaitDSPState); }     
-void AmpMenuState::       onMenuExit()              { transitionTo(&ampOffState);     }
-void AmpWaitDSPState::    onDSPConnected()          { transitionTo(&ampWaitSourceState); }
-void AmpWaitDSPState::    onDSPTimeout()            { transitionTo(&ampCylcePowerState); }
-void AmpCyclePowerState:: onTime()                  { transitionTo(&ampWaitDSPState); }
-void AmpWaitSourceState:: toSetGain()               { transitionTo(&ampSetGainState); }
-void AmpSetGainState::    toWaitVolume()            { transitionTo(&ampWaitVolumeState); }  // when source verified to match triggers
-void AmpWaitVolumeState:: toWaitMute()              { transitionTo(&ampWaitMuteState); }    // when volume verified to be within limits
-void AmpWaitMuteState::   toOn()                    { transitionTo(&ampOnState); }          // when mute verified to be off
-void AmpOnState::         onRemotePower()           { transitionTo(&ampOffState); }
-void AmpOnState::         onButtonFullHold()        { transitionTo(&ampOffState); }
-void AmpOnState::         toOff()                   { transitionTo(&ampOffState); }         // silence without trigger, or trigger loss when the other is low
-void AmpOnState::         toSource()                { transitionTo(&ampWaitSourceState); }  // trigger loss when the other is high
-void AmpOnState::         onRemotePreset()          { transitionTo(&ampChoosePreState); }
-void AmpChoosePreState::  toSetPreset()             { transitionTo(&ampSetPreState); }      // timeout when a new preset has been chosen
-void AmpChoosePreState::  toOn()                    { transitionTo(&ampOnState); }          // timeout if the preset hasn't been changed
-void AmpSetPreState::     onDSPPreset(uint8_t)      { transitionTo(&ampOnState); }
-void AmpSetPreState::     toOn()                    { transitionTo(&ampOnState); }          // on entry without setting intended preset
+// Guards for the transition table (StateTable.h)
+bool presetChanged() { return ampChoosePreState.changed(); }
+bool warmStandbyEnabled() { return ampOptions.warmStandbyTime; }
 
 // The state pattern context
 
 AmpState * ampState {&ampOffState}; 
+ampStateId_t ampStateId {ampStateId_t::Off};
+
+// The state objects, in ampStateId_t order
+AmpState * const ampStates[] {
+  &ampOffState, &ampMenuState, &ampWaitDSPState, &ampCylcePowerState, &ampWaitSourceState, &ampSetGainState,
+  &ampWaitVolumeState, &ampWaitMuteState, &ampOnState, &ampChoosePreState, &ampSetPreState, &ampWarmStandbyState
+};
+static_assert(sizeof(ampStates) / sizeof(ampStates[0]) == (uint8_t)ampStateId_t::Count, "A state object for each state id");
+
+// The last transitions, for post-mortem debugging
+TransitionTrace<32> transitionTrace;
+
+// Events from the callbacks, dispatched to the state once per pass of the loop. Input levels arrive
+// every INTERVAL and only the latest matters, so they are held apart and dispatched after the rest,
+// so that a burst of them can never hold up the knob or the remote. With RTOS_TASKS the USB task posts
+// events too, so the queue and the levels are shared (LOCK_SHARED).
+EventQueue<AmpEvent, 16> ampEvents;
+AmpEvent latestLevels;
+bool levelsPending {false};
+
+// Time from posting to dispatch, in us
+struct DispatchStats {
+  uint32_t events;
+  uint32_t totalLatency;
+  uint32_t maxLatency;
+} dispatchStats {0, 0, 0};
+
+AmpEvent newEvent(ampEvent_t type) {
+  AmpEvent event;
+  event.type = type;
+  event.time = micros();
+  return event;
+}
+
+void post(const AmpEvent & event) {
+  LOCK_SHARED();
+  ampEvents.post(event);
+  UNLOCK_SHARED();
+}
+void post(ampEvent_t type) { post(newEvent(type)); }
+
+void dispatch(AmpEvent & event) {
+  uint32_t latency = micros() - event.time;
+  dispatchStats.events++;
+  dispatchStats.totalLatency += latency;
+  dispatchStats.maxLatency = max(dispatchStats.maxLatency, latency);
+
+  causeTime = event.time;
+  powerOnPlan.note(event);
+  PROBE_EVENT(event.type);
+  switch (event.type) {
+    case ampEvent_t::DSPConnected:            ampState->onDSPConnected(); break;
+    case ampEvent_t::DSPTimeout:              ampState->onDSPTimeout(); break;
+    case ampEvent_t::DSPLost:                 ampState->onDSPLost(); break;
+    case ampEvent_t::DSPVolume:               ampState->onDSPVolume(event.value); break;
+    case ampEvent_t::DSPMute:                 ampState->onDSPMute(event.flag); break;
+    case ampEvent_t::DSPSource:               ampState->onDSPSource(event.source); break;
+    case ampEvent_t::DSPPreset:               ampState->onDSPPreset(event.value); break;
+    case ampEvent_t::DSPInputLevels:
+      RECORD_STIMULUS(levels(event.levels[1], event.levels[0]));   // Here, as the log is loop()'s alone
+      ampState->onDSPInputLevels(event.levels);
+      break;
+    case ampEvent_t::DSPInputGains:           ampState->onDSPInputGains(event.levels); break;
+    case ampEvent_t::ButtonShortPress:        ampState->onButtonShortPress(); break;
+    case ampEvent_t::ButtonLongPressPending:  ampState->onButtonLongPressPending(); break;
+    case ampEvent_t::ButtonLongPress:         ampState->onButtonLongPress(); break;
+    case ampEvent_t::ButtonFullHold:          ampState->onButtonFullHold(); break;
+    case ampEvent_t::KnobTurned:              ampState->onKnobTurned(event.change); break;
+    case ampEvent_t::RemoteVolPlus:           ampState->onRemoteVolPlus(); break;
+    case ampEvent_t::RemoteVolMinus:          ampState->onRemoteVolMinus(); break;
+    case ampEvent_t::RemoteMute:              ampState->onRemoteMute(); break;
+    case ampEvent_t::RemoteSource:            ampState->onRemoteSource(); break;
+    case ampEvent_t::RemotePower:             ampState->onRemotePower(); break;
+    case ampEvent_t::RemotePreset:            ampState->onRemotePreset(); break;
+    case ampEvent_t::TriggerRise:             ampState->onTriggerRise(event.triggers); break;
+    case ampEvent_t::TriggerFall:             ampState->onTriggerFall(event.triggers); break;
+    case ampEvent_t::Silence:                 ampState->onSilence(); break;
+    case ampEvent_t::MenuExit:                ampState->onMenuExit(); break;
+    case ampEvent_t::Count:                   break;
+  }
+  causeTime = 0;
+}
+
+// Dispatch the events waiting at the start of the pass. Any posted meanwhile wait for the next pass.
+void dispatchEvents() {
+  AmpEvent event;
+  for (uint8_t waiting = ampEvents.depth(); waiting; waiting--) {
+    LOCK_SHARED();
+    bool any = ampEvents.next(event);
+    UNLOCK_SHARED();
+    if (!any) break;
+    dispatch(event);
+  }
+  LOCK_SHARED();
+  bool levels = levelsPending;
+  if (levels) event = latestLevels;
+  levelsPending = false;
+  UNLOCK_SHARED();
+  if (levels) dispatch(event);
+}
+
+#ifdef INCLUDE_DEBUG
+// DEBUG: time asleep in standby, and what woke it, since the last report
+void printStandbyStats() {
+  Standby::instance().printStats(Serial);
+  Standby::instance().resetStats();
+}
 
-void polls() { ampState->polls(); }
-void requests() { ampState->requests(); }
-void onDSPConnected() { ampState->onDSPConnected(); }
-void onDSPVolume(uint8_t volume) { ampState->onDSPVolume(volume); }
-void onDSPMute(bool mute) { ampState->onDSPMute(mute); }
-void onDSPSource(source_t source) { ampState->onDSPSource(source); }
-void onDSPPreset(uint8_t preset) { ampState->onDSPPreset(preset); }
-void onDSPInputLevels(float * levels) { ampState->onDSPInputLevels(levels); }
-void onDSPInputGains(float * gains) { ampState->onDSPInputGains(gains); }
-void onButtonShortPress() { ampState->onButtonShortPress(); }
-void onButtonLongPressPending() { ampState->onButtonLongPressPending(); }
-void onButtonLongPress() { ampState->onButtonLongPress(); }
-void onButtonFullHold() { ampState->onButtonFullHold(); }
-void onKnobTurned(int8_t change) { ampState->onKnobTurned(change); }
-void onRemoteVolPlus() { ampState->onRemoteVolPlus(); }
-void onRemoteVolMinus(){ ampState->onRemoteVolMinus(); }
-void onRemoteMute() { ampState->onRemoteMute(); }
-void onRemoteSource() { ampState->onRemoteSource(); }
-void onRemotePower() { ampState->onRemotePower(); }
-void onRemotePreset() { ampState->onRemotePreset(); }
-void onTriggerRise(trigger_t source) { ampState->onTriggerRise(source); }
-void onTriggerFall(trigger_t source) { ampState->onTriggerFall(source); }
-void onSilence() { ampState->onSilence(); }
-void onMenuExit() { ampState->onMenuExit(); }
-
-void transitionTo(AmpState * newState) {
-  ampState = newState;
+// DEBUG: time from an event to the command it led to going to the MiniDSP, since the last report
+void printCommandStats() {
+  Serial.printf("Commands %lu, latency mean %lu us, max %lu us, coalesced %lu, dropped %lu\n",
+    commandStats.commands, commandStats.commands ? commandStats.totalLatency / commandStats.commands : 0,
+    commandStats.maxLatency, commandStats.coalesced, commandStats.dropped);
+  commandStats = {0, 0, 0, 0, 0};
+}
+
+// DEBUG: CPU time and overruns of the loop's tasks since the last report
+void printSchedulerStats() {
+  scheduler.print(Serial);
+  scheduler.resetStats();
+}
+
+// DEBUG: event dispatch latency (posting to handling) since the last report, and queue use
+void printDispatchStats() {
+  Serial.printf("Events %lu, latency mean %lu us, max %lu us, queue max %u, dropped %u\n",
+    dispatchStats.events, dispatchStats.events ? dispatchStats.totalLatency / dispatchStats.events : 0,
+    dispatchStats.maxLatency, ampEvents.maxDepth(), ampEvents.dropped());
+  dispatchStats = {0, 0, 0};
+}
+#endif
+
+// The loop's tasks
+bool statePolls() { PROBE(State); ampState->polls(); return true; }
+bool eventDispatch() { PROBE(Events); dispatchEvents(); return true; }
+bool triggerSampling() {
+  PROBE(Triggers);
+  triggerMonitor.task();
+  RECORD_STIMULUS(triggers(triggerMonitor.analogSample(), triggerMonitor.digitalSample(), triggerLogDeadband));
+  return true;
+}
+bool powerSequencing() { PROBE(Power); powerControl.task(); return true; }
+bool displayTask() { PROBE(Display); ampDisp.task(); return true; }
+
+// A loop task that draws. With RTOS_TASKS it holds the display only while it runs, so the display
+// task gets in between the tasks of a pass rather than only between passes.
+#if RTOS_TASKS
+template <taskFunction_t task> bool drawing() {
+  xSemaphoreTake(displayMutex, portMAX_DELAY);
+  bool ran = task();
+  xSemaphoreGive(displayMutex);
+  return ran;
+}
+#define DRAWING(task) drawing<task>
+#else
+#define DRAWING(task) task
+#endif
+
+// Hold the next request until every MiniDSP has answered the last one (and, with RTOS_TASKS,
+// the USB task has sent every command)
+bool requests() {
+  #if RTOS_TASKS
+  if (commandsPending()) return false;
+  #endif
+  if (!dspStatus().acknowledged) return false;
+  PROBE(Requests);
+  ampState->requests();
+  return true;
+}
+
+#if TIMING_PROBES || STIMULUS_LOG
+// Commands on Serial: 'p' prints the probes, 'r' resets them, 'l' dumps the stimulus log
+bool console() {
+  while (Serial.available()) {
+    switch (Serial.read()) {
+      #if TIMING_PROBES
+      case 'p':
+        printProbes(Serial);
+        Serial.printf("Ready %lu ms after boot\n", readyTime);
+        powerOnPlan.print(Serial);
+        break;
+      case 'r': resetProbes(); break;
+      #endif
+      #if STIMULUS_LOG
+      case 'l': stimulusLog.dump(Serial, ampOptions); break;
+      #endif
+    }
+  }
+  return true;
+}
+#endif
+
+// Callbacks: each posts an event. Those from the USB stack publish the DSP status first.
+void onDSPConnected() { usbRecovery.connected(); publishDSPStatus(); post(ampEvent_t::DSPConnected); }
+void onDSPUnitConnected() { if (dspGroup.connected()) onDSPConnected(); }  // Carry on once every MiniDSP has enumerated
+void onDSPTimeout() { publishDSPStatus(); post(ampEvent_t::DSPTimeout); }
+void onDSPLost() { publishDSPStatus(); post(ampEvent_t::DSPLost); }          // From either unit
+void postDSPVolume(uint8_t volume) { AmpEvent e = newEvent(ampEvent_t::DSPVolume); e.value = volume; post(e); }
+void postDSPMute(bool mute) { AmpEvent e = newEvent(ampEvent_t::DSPMute); e.flag = mute; post(e); }
+void onDSPVolume(uint8_t volume) { publishDSPStatus(); postDSPVolume(volume); }
+void onDSPMute(bool mute) { publishDSPStatus(); postDSPMute(mute); }
+void onDSPSource(source_t source) { publishDSPStatus(); AmpEvent e = newEvent(ampEvent_t::DSPSource); e.source = source; post(e); }
+void onDSPPreset(uint8_t preset) { publishDSPStatus(); AmpEvent e = newEvent(ampEvent_t::DSPPreset); e.value = preset; post(e); }
+void onDSPInputLevels(float * levels) {
+  publishDSPStatus();
+  AmpEvent e = newEvent(ampEvent_t::DSPInputLevels);
+  memcpy(e.levels, levels, sizeof(e.levels));
+  LOCK_SHARED();
+  latestLevels = e;
+  levelsPending = true;
+  UNLOCK_SHARED();
+}
+void onDSPInputGains(float * gains) {
+  publishDSPStatus();
+  AmpEvent e = newEvent(ampEvent_t::DSPInputGains);
+  memcpy(e.levels, gains, sizeof(e.levels));
+  post(e);
+}
+void onButtonShortPress() { post(ampEvent_t::ButtonShortPress); }
+void onButtonLongPressPending() { post(ampEvent_t::ButtonLongPressPending); }
+void onButtonLongPress() { post(ampEvent_t::ButtonLongPress); }
+void onButtonFullHold() { post(ampEvent_t::ButtonFullHold); }
+void onKnobTurned(int8_t change) {
+  RECORD_STIMULUS(knob(change));
+  AmpEvent e = newEvent(ampEvent_t::KnobTurned);
+  e.change = change;
+  post(e);
+}
+void onRemoteVolPlus() { post(ampEvent_t::RemoteVolPlus); }
+void onRemoteVolMinus(){ post(ampEvent_t::RemoteVolMinus); }
+void onRemoteMute() { post(ampEvent_t::RemoteMute); }
+void onRemoteSource() { post(ampEvent_t::RemoteSource); }
+void onRemotePower() { post(ampEvent_t::RemotePower); }
+void onRemotePreset() { post(ampEvent_t::RemotePreset); }
+void onRemoteFrame(uint8_t protocol, uint8_t bits, uint32_t value) { RECORD_STIMULUS(remote(protocol, bits, value)); }
+void onTriggerRise(trigger_t source) { AmpEvent e = newEvent(ampEvent_t::TriggerRise); e.triggers = source; post(e); }
+void onTriggerFall(trigger_t source) { AmpEvent e = newEvent(ampEvent_t::TriggerFall); e.triggers = source; post(e); }
+void onSilence() { post(ampEvent_t::Silence); }
+void onMenuExit() { post(ampEvent_t::MenuExit); }
+
+// Find the row for the trigger and take the first whose guard passes. fire() has checked at compile
+// time that there is one; a handler of a state that has already been left finds nothing here.
+void takeTransition(ampStateId_t from, ampTrigger_t trigger) {
+  if (from != ampStateId) return;
+  for (const transition_t & t : ampTransitions) {
+    if (t.from == from && t.trigger == trigger && (!t.guard || t.guard())) {
+      enterState(t.to, trigger);
+      return;
+    }
+  }
+}
+
+void enterState(ampStateId_t to, ampTrigger_t trigger) {
+  ampState->onExit();
+  transitionTrace.record(millis(), ampStateId, trigger, to);
+  ampStateId = to;
+  ampState = ampStates[(uint8_t)to];
   ampState->onEntry();
 }
 
+#ifdef INCLUDE_DEBUG
+// DEBUG: the last transitions, oldest first
+void printTransitionTrace() { transitionTrace.print(Serial); }
+
+// DEBUG: time from the edge to each phase of power-on
+void printPowerOnTimes() { powerOnPlan.print(Serial); }
+#endif
+
+#if RTOS_TASKS
+// The USB task: carry out the commands, then poll the host shield and the recovery. Transfers busy-wait
+// on the SPI bus, so it shares the CPU with loop() a tick at a time rather than outranking it.
+void usbTask(void * parameters) {
+  for (;;) {
+    DSPCommand command;
+    while (takeCommand(command)) {
+      runCommand(command);
+      publishDSPStatus();
+      LOCK_SHARED();
+      lastDone = command.seq;
+      UNLOCK_SHARED();
+    }
+    if (Standby::instance().active()) {               // The host shield is powered down
+      vTaskDelay(ms2tick(triggerSamplePeriod));
+      continue;
+    }
+    {
+      PROBE(USB);
+      thisUSB.Task();
+    }
+    {
+      PROBE(Recovery);
+      usbRecovery.Task();                             // Calls onDSPTimeout() when only a power cycle is left
+    }
+    publishDSPStatus();
+    vTaskDelay(1);
+  }
+}
+
+// The display task: frames, fades and dimming, between loop() passes. Above loop() in priority,
+// so it runs as soon as a task that draws lets go of the display.
+void displaySendTask(void * parameters) {
+  for (;;) {
+    xSemaphoreTake(displayMutex, portMAX_DELAY);
+    displayTask();
+    xSemaphoreGive(displayMutex);
+    vTaskDelay(1);
+  }
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
   //while(!Serial) delay(10);
+  #if TIMING_PROBES
+  probesBegin();
+  #endif
 
   powerControl.begin();
   optionsSetup();
   DisplaySetup();
   if (goButton.rawClosed()) BLESetup();
   knob.begin();
+  Standby::instance().begin(ENCODER_BUTTON);
   ourRemote.listen();
   triggerMonitor.begin();
 
   //animateLogo();
   showLogo(true);
-  delay(2000);
+  ampDisp.flush();
+  logoUntil = millis() + logoTime;
 
   // Init is called with each entry to WaitDSP, so it's possibly not needed here.
   // But it's helpful to know at power-on if something's wrong with the UHS
   if(thisUSB.Init() == -1) {
     ampDisp.displayMessage("USB didn't start.");
-    ampDisp.refresh();
+    ampDisp.flush();
     while(1); // Halt
   }
 
   // Register callbacks.
-  ourMiniDSP.attachOnInit(&onDSPConnected);
+  ourMiniDSP.attachOnInit(&onDSPUnitConnected);
+  ourMiniDSP.attachOnRelease(&onDSPLost);
+#if MINIDSP_UNITS > 1
+  secondMiniDSP.attachOnInit(&onDSPUnitConnected);
+  secondMiniDSP.attachOnRelease(&onDSPLost);
+  dspGroup.add(&secondMiniDSP);
+#endif
+  usbRecovery.attachPowerCycle(&onDSPTimeout);
   ourMiniDSP.attachOnVolumeChange(&onDSPVolume);
   ourMiniDSP.attachOnMutedChange(&onDSPMute);
   ourMiniDSP.attachOnPresetChange(&onDSPPreset);
@@ -839,17 +1570,43 @@ void setup() {
 
   ourMiniDSP.callbackOnResponse();              // We want a callback even if the value is unchanged
 
-  lastTime = millis();
+  // The loop's tasks, by priority. Polls and events every pass, so the remote, knob and USB are served
+  // as soon as possible; the triggers at the 50 ms sample rate their filters are designed for.
+  //             name        function                period               deadline  priority
+  scheduler.add("state",    DRAWING(statePolls),    0,                   5,        0);
+  scheduler.add("events",   DRAWING(eventDispatch), 0,                   5,        1);
+  scheduler.add("triggers", triggerSampling,        triggerSamplePeriod, 10,       2);
+  scheduler.add("power",    powerSequencing,        10,                  10,       2);
+  requestsTask =
+  scheduler.add("requests", DRAWING(requests),      INTERVAL,            INTERVAL, 3);
+  #if TIMING_PROBES || STIMULUS_LOG
+  scheduler.add("console",  console,                100,                 100,      5);
+  #endif
+  #if !RTOS_TASKS
+  scheduler.add("display",  displayTask,            0,                   5,        4);
+  #else
+  dspCommands = xQueueCreate(16, sizeof(DSPCommand));
+  displayMutex = xSemaphoreCreateMutex();
+  publishDSPStatus();     // Before the state machine first reads it
+  #endif
+
+  enterState(ampStateId_t::Off, ampTrigger_t::Start);
+
+  #if RTOS_TASKS
+  xTaskCreate(usbTask, "usb", 1024, NULL, TASK_PRIO_LOW, NULL);           // Round robin with loop()
+  xTaskCreate(displaySendTask, "display", 512, NULL, TASK_PRIO_NORMAL, NULL);
+  #endif
+}
 
-  transitionTo(&ampOffState);
+void pass() {
+  PROBE(Pass);
+  scheduler.run();
 }
 
 void loop() {
-  polls();
+  pass();
 
-  uint32_t currentTime = millis();
-  if ((currentTime - lastTime) >= INTERVAL) {
-    requests();
-    lastTime = currentTime;
-  }
+  // Sleep, if the state allows, until an input wakes it or a task falls due
+  uint32_t idleStart = micros();
+  if (ampState->idle(scheduler.untilDue(1000000) / 1000)) scheduler.slept(idleStart);
 }
@@ -4,12 +4,65 @@
 
     // Globals that are private to this translation unit
     uint8_t volSpaceWidth;      // Width of a space character - for padding strings
-    uint8_t dBSpaceWidth;    
+    uint8_t dBSpaceWidth;
+
+    // Volume strings for every MiniDSP volume step (-0.5 dB each), built at compile time so that
+    // drawing the volume needs no float math or printf. Formatted as "%3.1f" (dB) and "%3u" (%) were.
+    struct VolumeText {
+        char dB[7];         // "-127.5"
+        char percent[4];    // "100", " 50"
+    };
+
+    constexpr uint8_t decimalDigits(uint8_t n) { return n >= 100 ? 3 : n >= 10 ? 2 : 1; }
+    constexpr uint8_t powerOf10(uint8_t n) { return n ? 10 * powerOf10(n - 1) : 1; }
+    constexpr char digitAt(uint8_t n, uint8_t i) { return '0' + n / powerOf10(decimalDigits(n) - 1 - i) % 10; }
+
+    // Character i of the dB string: sign (except at 0 dB), whole dB, '.', then 0 or 5 tenths
+    constexpr char dBChar(uint8_t step, uint8_t sign, uint8_t digits, uint8_t i) {
+        return i < sign ? '-'
+            : i < sign + digits ? digitAt(step / 2, i - sign)
+            : i == sign + digits ? '.'
+            : i == sign + digits + 1 ? (step & 1 ? '5' : '0')
+            : '\0';
+    }
+    constexpr char dBChar(uint8_t step, uint8_t i) { return dBChar(step, step ? 1 : 0, decimalDigits(step / 2), i); }
+
+    // Percent of the range from -128 dB (0%) to 0 dB (100%), right justified in 3 characters
+    constexpr uint8_t volumePercent(uint8_t step) { return (256 - step) * 100 / 256; }
+    constexpr char percentChar(uint8_t percent, uint8_t i) {
+        return i < 3 - decimalDigits(percent) ? ' ' : i < 3 ? digitAt(percent, i - (3 - decimalDigits(percent))) : '\0';
+    }
+
+    constexpr VolumeText volumeText(uint8_t step) {
+        return {
+            {dBChar(step, 0), dBChar(step, 1), dBChar(step, 2), dBChar(step, 3), dBChar(step, 4), dBChar(step, 5), '\0'},
+            {percentChar(volumePercent(step), 0), percentChar(volumePercent(step), 1), percentChar(volumePercent(step), 2), '\0'}
+        };
+    }
+
+    // The steps 0..255 as a parameter pack
+    template <uint8_t... Steps> struct VolumeSteps {};
+    template <uint16_t N, uint8_t... Steps> struct AllVolumeSteps : AllVolumeSteps<N - 1, N - 1, Steps...> {};
+    template <uint8_t... Steps> struct AllVolumeSteps<0, Steps...> { typedef VolumeSteps<Steps...> type; };
+
+    struct VolumeTable {
+        VolumeText step[256];
+    };
+
+    template <uint8_t... Steps> constexpr VolumeTable makeVolumeTable(VolumeSteps<Steps...>) {
+        return {{volumeText(Steps)...}};
+    }
+
+    constexpr VolumeTable volumeTable = makeVolumeTable(AllVolumeSteps<256>::type());
 
     void AmpDisplay::drawFrame()
     {
-        // Clear the display buffer
-        display->clear();
+        // Clear the display buffer. The whole screen is re-sent, so drop any frame still being sent.
+        display->clearBuffer();
+        barsShown = false;
+        sending = false;
+        refreshPending = false;
+        invalidate();
 
         // Draw whatever dividing lines, etc. we need
         displayUpdate();
@@ -17,29 +70,167 @@
 
     void AmpDisplay::displayUpdate() {
         if (autoRefresh) {
-            display->updateDisplay();
-            newContent = false;
+            flush();
         } else {
             newContent = true;
         }
     }
 
     void AmpDisplay::refresh() {
+        if (newContent) refreshPending = true;
+    }
+
+    void AmpDisplay::flush() {
+        while (sending) sendTiles(maxTileRows * maxTileColumns);
+        refreshPending = false;
         if (newContent) {
-            display->updateDisplay();
-            newContent = false;
+            startFrame();
+            sendTiles(maxTileRows * maxTileColumns);
+        }
+    }
+
+    void AmpDisplay::task() {
+        if (sending) {
+            sendTiles(FLUSH_TILES);
+            return;
+        }
+        if (!refreshPending && !fading && !(autoDim && !dimState)) return;   // Idle
+
+        uint32_t now = millis();
+        if ((now - frameTime) < frameInterval) return;
+        frameTime = now;
+
+        if (autoDim && !dimState && (now - brightTime) > ampOptions.dimTime * 1000UL) dim();
+        if (fading) stepFade(now);
+        if (refreshPending) {
+            refreshPending = false;
+            if (newContent) startFrame();
+        }
+    }
+
+    void AmpDisplay::startFade(uint8_t brightness, uint16_t time) {
+        uint16_t target = brightness << 8;
+        if (!fading && fadeLevel == target && sentContrast >= 0) return;
+        fadeFrom = fadeLevel;
+        fadeTarget = target;
+        fadeStart = millis();
+        fadeTime = time;
+        fading = true;
+    }
+
+    void AmpDisplay::stepFade(uint32_t now) {
+        uint32_t elapsed = now - fadeStart;
+        if (elapsed >= fadeTime) {
+            fadeLevel = fadeTarget;
+            fading = false;
+        } else {
+            fadeLevel = fadeFrom + ((int32_t)fadeTarget - fadeFrom) * (int32_t)elapsed / fadeTime;
+        }
+        uint8_t value = fadeContrast(fadeLevel);
+        if (value != sentContrast) {
+            display->setContrast(value);
+            sentContrast = value;
+        }
+    }
+
+    void AmpDisplay::setFrameInterval(uint16_t interval) {
+        frameInterval = interval;
+    }
+
+    void AmpDisplay::invalidate() {
+        uint8_t tileRows = min(display->getBufferTileHeight(), (uint8_t)maxTileRows);
+        uint16_t allColumns = ((1UL << display->getBufferTileWidth()) - 1) & allTileColumns;
+        for (uint8_t row = 0; row < tileRows; row++) dirtyTiles[row] = allColumns;
+        newContent = true;
+    }
+
+    void AmpDisplay::markDirty(int16_t XL, int16_t YT, int16_t XR, int16_t YB) {
+        int16_t width = display->getDisplayWidth();
+        int16_t height = display->getDisplayHeight();
+        XL = max(XL, (int16_t)0);
+        YT = max(YT, (int16_t)0);
+        XR = min(XR, (int16_t)(width - 1));
+        YB = min(YB, (int16_t)(height - 1));
+        if (XL > XR || YT > YB) return;
+
+        // The buffer, and so updateDisplayArea(), is in the controller's orientation, so undo the rotation.
+        int16_t tx0, ty0, tx1, ty1;
+        const u8g2_cb_t * rotation = display->getU8g2()->cb;
+        if (rotation == U8G2_R0) {
+            tx0 = XL;  ty0 = YT;  tx1 = XR;  ty1 = YB;
+        } else if (rotation == U8G2_R1) {
+            tx0 = height - 1 - YB;  ty0 = XL;  tx1 = height - 1 - YT;  ty1 = XR;
+        } else if (rotation == U8G2_R2) {
+            tx0 = width - 1 - XR;  ty0 = height - 1 - YB;  tx1 = width - 1 - XL;  ty1 = height - 1 - YT;
+        } else if (rotation == U8G2_R3) {
+            tx0 = YT;  ty0 = width - 1 - XR;  tx1 = YB;  ty1 = width - 1 - XL;
+        } else {
+            invalidate();   // Mirrored; not worth the bookkeeping
+            return;
+        }
+
+        uint16_t columns = ((1UL << (tx1 / 8 + 1)) - 1) & ~((1UL << (tx0 / 8)) - 1) & allTileColumns;
+        for (int16_t row = ty0 / 8; row <= ty1 / 8 && row < maxTileRows; row++) dirtyTiles[row] |= columns;
+    }
+
+    void AmpDisplay::startFrame() {
+        uint8_t tileRows = min(display->getBufferTileHeight(), (uint8_t)maxTileRows);
+        uint16_t rowBytes = display->getBufferTileWidth() * 8;
+        const uint8_t * buffer = display->getBufferPtr();
+
+        for (uint8_t row = 0; row < tileRows; row++) {
+            uint16_t columns = dirtyTiles[row];
+            for (uint8_t column = 0; columns; column++, columns >>= 1) {
+                if (columns & 1) memcpy(frameTiles[row][column], buffer + row * rowBytes + column * 8, 8);
+            }
+            sendingTiles[row] = dirtyTiles[row];
+            dirtyTiles[row] = 0;
+        }
+        newContent = false;
+        frameTime = millis();
+        sendRow = 0;
+        sending = true;
+        frameStall = 0;
+        frameTileCount = 0;
+    }
+
+    void AmpDisplay::sendTiles(uint16_t maxTiles) {
+        uint32_t start = micros();
+
+        while (maxTiles && sendRow < maxTileRows) {
+            uint16_t columns = sendingTiles[sendRow];
+            if (!columns) {
+                sendRow++;
+                continue;
+            }
+            uint8_t column = __builtin_ctz(columns);
+            uint8_t run = 0;
+            while (run < maxTiles && (columns >> (column + run)) & 1) run++;
+            u8x8_DrawTile(display->getU8x8(), column, sendRow, run, frameTiles[sendRow][column]);
+            sendingTiles[sendRow] &= ~(((1UL << run) - 1) << column);
+            maxTiles -= run;
+            frameTileCount += run;
+        }
+
+        frameStall = max(frameStall, micros() - start);
+        if (sendRow >= maxTileRows) {
+            u8x8_RefreshDisplay(display->getU8x8());   // Only does anything on e-paper, as in updateDisplayArea()
+            sending = false;
+            refreshMicros = frameStall;
+            refreshTiles = frameTileCount;
         }
     }
 
     void AmpDisplay::setImmediateUpdate(bool immediate) {
         autoRefresh = immediate;
-        if (autoRefresh && newContent) refresh();
+        if (autoRefresh) flush();
     }
 
     void AmpDisplay::drawVolume()
     {
-        char volString[8];
         uint8_t vsWidth;
+        const VolumeText & text = volumeTable.step[volumeState & 0xFF];
+        bool known = volumeState >= 0;
 
         if (muteState)
         {
@@ -50,16 +241,13 @@
         else if (dBDisplay)
         {
             // display is -xxx.x dB with dB half-sized at baseline
-            snprintf(volString, 7, "%3.1f", volumeState);
-            displayText(volString, VOL_DB_FONT, volumeArea, true);
+            displayText(known ? text.dB : "", VOL_DB_FONT, volumeArea, true);
             displayText("dB", DB_FONT, volLabArea, true);
         }
         else
         {
             // display is xxx %
-            uint8_t volPct = (volumeState - MIN_VOLUME) / (MAX_VOLUME - MIN_VOLUME) * 100;
-            snprintf(volString, 7, "%3u", volPct);
-            displayText(volString, VOL_PCT_FONT, volumeArea, true);
+            displayText(known ? text.percent : "", VOL_PCT_FONT, volumeArea, true);
             displayText("%", PCT_FONT, volLabArea, true);
         }
 
@@ -96,7 +284,7 @@
         displayUpdate();
     }
 
-    void AmpDisplay::volume(float vol)
+    void AmpDisplay::volume(uint8_t vol)
     {
     //    if (volumeState != vol)
     //    {
@@ -132,7 +320,7 @@
     // @brief Dims the display
     void AmpDisplay::dim() {
         if (dimState) return;
-        display->setContrast(contrast(ampOptions.brightness.lowBrightness - 1));
+        startFade(ampOptions.brightness.lowBrightness - 1, DIM_FADE_TIME);
         dimState = true;
     #ifdef TRANSIENTVOLUME
         if (!muteState) eraseVolume();
@@ -147,16 +335,16 @@
     brightTime = millis();
     }
 
-    void AmpDisplay::checkDim() {
-    if (dimState) return;
-    uint32_t currentTime = millis();
-    if ((currentTime - brightTime) > ampOptions.dimTime * 1000) {
-        dim();
+    void AmpDisplay::setAutoDim(bool enable) {
+        autoDim = enable;
+        if (!enable) {
+            fading = false;
+            sentContrast = -1;
         }
     }
 
     void AmpDisplay::undim() {
-        display->setContrast(contrast(ampOptions.brightness.highBrightness));
+        startFade(ampOptions.brightness.highBrightness, WAKE_FADE_TIME);
         dimState = false;
     }
     
@@ -164,7 +352,7 @@
     #ifdef TRANSIENTVOLUME
         if (!volumeShown) drawVolume();
     #endif
-        display->setContrast(contrast(ampOptions.brightness.highBrightness));
+        startFade(ampOptions.brightness.highBrightness, WAKE_FADE_TIME);
         dimState = false;
         scheduleDim();
     }
@@ -226,8 +414,10 @@
     }
 
     void AmpDisplay::eraseArea(areaSpec_t area) {
+        coverBars(area);
         display->setDrawColor(0);
         display->drawBox(area.XL, area.YT, area.XR - area.XL, area.YB - area.YT);
+        markDirty(area);
     }
 
     void AmpDisplay::displayText(const char *text, const uint8_t *font, areaSpec_t area, const bool erase, const uint8_t offset)
@@ -239,41 +429,318 @@
 
         if (!text[0]) return;
 
+        coverBars(area);
         display->setDrawColor(1);
         display->setFont(font);
         display->setFontPosBaseline();       // ArduinoMenu sets this to Bottom in the u8g2Out constructor :-(
-        if (area.rJust)
+        int16_t textWidth;
+        int16_t textXL;
+        if (!drawCachedText(text, area, area.YB + offset, textXL, textWidth))
         {
-            uint8_t vsWidth = display->getStrWidth(text);
-            //display->setCursor(area.XR - vsWidth, area.YB);
-            display->setCursor(area.XR - vsWidth, area.YB + offset);
+            textWidth = display->getStrWidth(text);
+            if (area.rJust)
+            {
+                textXL = area.XR - textWidth;
+                //display->setCursor(area.XR - vsWidth, area.YB);
+                display->setCursor(textXL, area.YB + offset);
+            }
+            else
+            {
+                textXL = area.XL;
+                //display->setCursor(area.XL, area.YB);
+                display->setCursor(area.XL, area.YB + offset);
+            }
+            display->print(text);
         }
-        else
-        {
-            //display->setCursor(area.XL, area.YB);
-            display->setCursor(area.XL, area.YB + offset);
+
+        // Text can spill out of its area (long strings, descenders), so mark what was actually drawn
+        markDirty(min(textXL, (int16_t)area.XL), area.YT,
+                  max((int16_t)(textXL + textWidth - 1), (int16_t)area.XR), area.YB + offset - display->getDescent());
+    }
+
+    bool AmpDisplay::drawCachedText(const char * text, areaSpec_t area, int16_t baseline, int16_t & textXL, int16_t & textWidth)
+    {
+        // No more glyphs than the cache holds, so looking up the last cannot evict the first
+        constexpr uint8_t maxGlyphs = GLYPH_CACHE_SIZE;
+        CachedGlyph * glyphs[maxGlyphs];
+        uint8_t count = 0;
+
+        if (!textCacheEnabled || display->getU8g2()->cb != U8G2_R1) return false;
+
+        const uint8_t * font = display->getU8g2()->font;
+        for (const char * c = text; *c; c++) {
+            if (count == maxGlyphs) return false;
+            glyphs[count] = cachedGlyph(font, *c);
+            if (!glyphs[count]) return false;
+            count++;
         }
-        display->print(text);
+
+        // Same width as getStrWidth(): advances, except the ink width of the last glyph
+        textWidth = 0;
+        for (uint8_t i = 0; i < count - 1; i++) textWidth += glyphs[i]->advance;
+        textWidth += glyphs[count - 1]->inkWidth ? glyphs[count - 1]->inkWidth : glyphs[count - 1]->advance;
+        textXL = area.rJust ? area.XR - textWidth : area.XL;
+
+        int16_t x = textXL;
+        for (uint8_t i = 0; i < count; i++) {
+            const CachedGlyph * glyph = glyphs[i];
+            for (uint8_t row = 0; row < glyph->height; row++) {
+                writeRow(x + glyph->left, baseline + glyph->top + row, glyph->width, glyph->ink[row], glyph->mask(row));
+            }
+            x += glyph->advance;
+        }
+        return true;
     }
 
-    void AmpDisplay::displayLRBarGraph(uint8_t left, uint8_t right, areaSpec_t area)
-    {        
-        // Erase the area
-        display->setDrawColor(0);
-        display->drawBox(area.XL, area.YT, area.XR - area.XL, area.YB - area.YT);
+    AmpDisplay::CachedGlyph * AmpDisplay::cachedGlyph(const uint8_t * font, uint8_t encoding)
+    {
+        u8g2_t * u8g2 = display->getU8g2();
+        if (encoding < ' ' || encoding > '~' || !u8g2_IsGlyph(u8g2, encoding)) return nullptr;
+
+        CachedGlyph * oldest = &glyphCache[0];
+        for (CachedGlyph & glyph : glyphCache) {
+            if (glyph.font == font && glyph.encoding == encoding) {
+                glyph.lastUse = ++glyphUseCount;
+                return &glyph;
+            }
+            if (!oldest->font) continue;
+            if (!glyph.font || (uint16_t)(glyphUseCount - glyph.lastUse) > (uint16_t)(glyphUseCount - oldest->lastUse)) oldest = &glyph;
+        }
+
+        // Not cached: measure it the way U8g2 does, then render it in the top left corner and copy it out.
+        // Rendering it on both a clear and a set background shows which pixels U8g2 writes: the ink,
+        // and in solid font mode a box around it. Anything else isn't cached.
+        int8_t advance = u8g2_GetGlyphWidth(u8g2, encoding);
+        uint8_t inkWidth = u8g2->font_decode.glyph_width ? u8g2->font_decode.glyph_width + u8g2->glyph_x_offset : 0;
+        int8_t left = min(0, (int)u8g2->glyph_x_offset);
+        int16_t width = max((int)advance, (int)inkWidth) - left;
+        uint8_t height = u8g2->font_info.max_char_height;
+        int8_t top = -(u8g2->font_info.y_offset + height - 1);
+        if (advance < 0 || width > MAX_GLYPH_WIDTH || height > MAX_GLYPH_ROWS) return nullptr;
+
+        uint32_t saved[MAX_GLYPH_ROWS];
+        for (uint8_t row = 0; row < height; row++) {
+            saved[row] = readRow(0, row, width);
+            writeRow(0, row, width, 0);
+        }
+        display->drawGlyph(-left, -top, encoding);
+        for (uint8_t row = 0; row < height; row++) {
+            oldest->ink[row] = readRow(0, row, width);
+            writeRow(0, row, width, 0xFFFFFFFF);
+        }
+        display->drawGlyph(-left, -top, encoding);
+        uint32_t widthMask = (width < 32) ? (1UL << width) - 1 : 0xFFFFFFFF;
+        uint32_t written[MAX_GLYPH_ROWS];
+        uint32_t boxColumns = 0;
+        uint8_t boxTop = height;
+        uint8_t boxEnd = 0;
+        bool solid = false;
+        for (uint8_t row = 0; row < height; row++) {
+            uint32_t unwritten = readRow(0, row, width) & ~oldest->ink[row];
+            written[row] = ~unwritten & widthMask;
+            if (written[row] != oldest->ink[row]) {
+                solid = true;
+                boxColumns |= written[row];
+                boxTop = min(boxTop, row);
+                boxEnd = row + 1;
+            }
+            writeRow(0, row, width, saved[row]);
+        }
+        oldest->font = nullptr;     // Whatever it held is gone
+        oldest->solid = solid;
+        oldest->boxTop = solid ? boxTop : 0;
+        oldest->boxHeight = solid ? boxEnd - boxTop : 0;
+        oldest->boxColumns = boxColumns;
+        for (uint8_t row = 0; row < height; row++) {
+            if (written[row] != oldest->mask(row)) return nullptr;
+        }
+
+        oldest->font = font;
+        oldest->encoding = encoding;
+        oldest->advance = advance;
+        oldest->inkWidth = inkWidth;
+        oldest->left = left;
+        oldest->width = width;
+        oldest->top = top;
+        oldest->height = height;
+        oldest->lastUse = ++glyphUseCount;
+        return oldest;
+    }
+
+    // Under U8G2_R1, logical pixel (x, y) is bit x % 8 of byte (height - 1 - y) in page x / 8
+    // (SH1107 and other vertical-byte controllers), so a row of pixels is a run of bits across pages.
+    void AmpDisplay::writeRow(int16_t x, int16_t y, uint8_t width, uint32_t bits, uint32_t mask)
+    {
+        int16_t height = display->getDisplayHeight();
+        int16_t displayWidth = display->getDisplayWidth();
+        if (y < 0 || y >= height) return;
+        if (x < 0) {
+            if (-x >= width) return;
+            bits >>= -x;
+            mask >>= -x;
+            width += x;
+            x = 0;
+        }
+        if (x + width > displayWidth) {
+            if (x >= displayWidth) return;
+            width = displayWidth - x;
+        }
+
+        uint8_t * column = display->getBufferPtr() + (height - 1 - y);
+        uint16_t pageBytes = display->getBufferTileWidth() * 8;
+        while (width) {
+            uint8_t shift = x % 8;
+            uint8_t n = min(width, (uint8_t)(8 - shift));
+            uint8_t byteMask = ((mask & ((1 << n) - 1)) << shift);
+            uint8_t & b = column[(x / 8) * pageBytes];
+            b = (b & ~byteMask) | ((bits << shift) & byteMask);
+            bits >>= n;
+            mask >>= n;
+            x += n;
+            width -= n;
+        }
+    }
+
+    uint32_t AmpDisplay::readRow(int16_t x, int16_t y, uint8_t width)
+    {
+        int16_t height = display->getDisplayHeight();
+        if (y < 0 || y >= height || x < 0 || x + width > display->getDisplayWidth()) return 0;
+
+        const uint8_t * column = display->getBufferPtr() + (height - 1 - y);
+        uint16_t pageBytes = display->getBufferTileWidth() * 8;
+        uint32_t bits = 0;
+        uint8_t done = 0;
+        while (done < width) {
+            uint8_t shift = x % 8;
+            uint8_t n = min((uint8_t)(width - done), (uint8_t)(8 - shift));
+            bits |= (uint32_t)((column[(x / 8) * pageBytes] >> shift) & ((1 << n) - 1)) << done;
+            x += n;
+            done += n;
+        }
+        return bits;
+    }
+
+    void AmpDisplay::useTextCache(bool enable) {
+        textCacheEnabled = enable;
+    }
+
+    uint32_t AmpDisplay::benchmarkVolume(uint16_t steps) {
+        int16_t savedVolume = volumeState;
+        uint8_t savedMute = muteState;
+        muteState = 0;
+
+        uint32_t start = micros();
+        for (uint16_t i = 0; i < steps; i++) {
+            volumeState = i % 256;
+            drawVolume();
+        }
+        uint32_t elapsed = micros() - start;
+
+        volumeState = savedVolume;
+        muteState = savedMute;
+        drawVolume();
+        return steps ? elapsed / steps : 0;
+    }
 
+    void AmpDisplay::displayLRBarGraph(uint8_t left, uint8_t right, areaSpec_t area, uint8_t leftPeak, uint8_t rightPeak)
+    {        
         // The bar graphs extend left and right from the center of the area
         // There's a two-pixel gap in the center
         // The area is assumed to have an even width
         uint8_t barWidth = (area.XR - area.XL + 1) / 2 ; // Assumes total area width is an even number
-        uint8_t leftAreaXR = area.XL + barWidth  - 2; 
-        uint8_t rightAreaXL = leftAreaXR + 2;
 
         uint8_t leftWidth = max( ( (int) left * (int) (barWidth) ) / 100, 1);
         uint8_t rightWidth = max( ( (int) right * (int) (barWidth) ) / 100, 1);
 
-        display->setDrawColor(1);
-        display->drawBox(leftAreaXR - leftWidth, area.YT + 2, leftWidth, area.YB - area.YT - 2);
-        display->drawBox(rightAreaXL, area.YT + 2, rightWidth, area.YB - area.YT - 2);
+        barPixels = 0;
+        if (!barsShown || memcmp(&area, &barArea, sizeof(area)))
+        {
+            // Erase the area and draw both bars in full
+            display->setDrawColor(0);
+            display->drawBox(area.XL, area.YT, area.XR - area.XL, area.YB - area.YT);
+            markDirty(area);
+            barPixels = (area.XR - area.XL) * (area.YB - area.YT);
+            barArea = area;
+            barsShown = true;
+            barLeftWidth = 0;
+            barRightWidth = 0;
+            barLeftMarker = 0;
+            barRightMarker = 0;
+        }
+
+        // Markers are only shown beyond the end of the bar, so erasing one never touches the bar
+        uint8_t leftMarker = ( (int) leftPeak * (int) (barWidth) ) / 100;
+        uint8_t rightMarker = ( (int) rightPeak * (int) (barWidth) ) / 100;
+        if (leftMarker <= leftWidth) leftMarker = 0;
+        if (rightMarker <= rightWidth) rightMarker = 0;
+        if (barLeftMarker && barLeftMarker != leftMarker) drawBarMarker(true, barLeftMarker - 1, false);
+        if (barRightMarker && barRightMarker != rightMarker) drawBarMarker(false, barRightMarker - 1, false);
+
+        // Draw the growth or erase the shrinkage of each bar
+        if (leftWidth != barLeftWidth) drawBarSpan(true, min(leftWidth, barLeftWidth), max(leftWidth, barLeftWidth), leftWidth > barLeftWidth);
+        if (rightWidth != barRightWidth) drawBarSpan(false, min(rightWidth, barRightWidth), max(rightWidth, barRightWidth), rightWidth > barRightWidth);
+        barLeftWidth = leftWidth;
+        barRightWidth = rightWidth;
+
+        if (leftMarker && leftMarker != barLeftMarker) drawBarMarker(true, leftMarker - 1, true);
+        if (rightMarker && rightMarker != barRightMarker) drawBarMarker(false, rightMarker - 1, true);
+        barLeftMarker = leftMarker;
+        barRightMarker = rightMarker;
+
         displayUpdate();  // Re-draw only, without full refresh and wakeup
     }
+
+    void AmpDisplay::drawBarSpan(bool leftBar, uint8_t from, uint8_t to, bool on)
+    {
+        uint8_t barWidth = (barArea.XR - barArea.XL + 1) / 2;
+        uint8_t leftAreaXR = barArea.XL + barWidth  - 2; 
+        uint8_t rightAreaXL = leftAreaXR + 2;
+        uint8_t top = barArea.YT + 2;
+        uint8_t height = barArea.YB - barArea.YT - 2;
+
+        // Columns are counted outwards from the center gap; x of the span's leftmost column
+        auto spanX = [&](uint8_t d0, uint8_t d1) { return leftBar ? leftAreaXR - d1 : rightAreaXL + d0; };
+
+        display->setDrawColor(on ? 1 : 0);
+        if (!on || !barSegmentPitch) {
+            display->drawBox(spanX(from, to), top, to - from, height);
+            barPixels += (to - from) * height;
+        } else {
+            // Light all but the last column of each segment
+            for (uint8_t d = from; d < to; ) {
+                uint8_t segmentEnd = (d / barSegmentPitch + 1) * barSegmentPitch - 1;
+                uint8_t end = min(segmentEnd, to);
+                if (end > d) {
+                    display->drawBox(spanX(d, end), top, end - d, height);
+                    barPixels += (end - d) * height;
+                }
+                d = segmentEnd + 1;
+            }
+        }
+        markDirty(spanX(from, to), top, spanX(from, to) + (to - from) - 1, top + height - 1);
+    }
+
+    void AmpDisplay::drawBarMarker(bool leftBar, uint8_t column, bool on)
+    {
+        uint8_t barWidth = (barArea.XR - barArea.XL + 1) / 2;
+        uint8_t leftAreaXR = barArea.XL + barWidth  - 2; 
+        uint8_t x = leftBar ? leftAreaXR - 1 - column : leftAreaXR + 2 + column;
+        uint8_t top = barArea.YT + 2;
+        uint8_t height = barArea.YB - barArea.YT - 2;
+
+        display->setDrawColor(on ? 1 : 0);
+        display->drawBox(x, top, 1, height);
+        barPixels += height;
+        markDirty(x, top, x, top + height - 1);
+    }
+
+    void AmpDisplay::setBarSegments(uint8_t pitch) {
+        barSegmentPitch = pitch;
+        barsShown = false;
+    }
+
+    void AmpDisplay::coverBars(areaSpec_t area) {
+        if (barsShown && area.XL <= barArea.XR && barArea.XL <= area.XR && area.YT <= barArea.YB && barArea.YT <= area.YB) {
+            barsShown = false;
+        }
+    }
@@ -12,10 +12,26 @@
 // Display settings of most interest to the user
 #define CONTRAST_FULL 128
 #define CONTRAST_DIM 16
+#define DIM_FADE_TIME   1500    // Time (ms) to fade down to the dim level
+#define WAKE_FADE_TIME  150     // Time (ms) to fade back up; short, as it answers a knob turn or button press
 
 // Options
 #define DBDISPLAY true  // Display volume in dB (instead of %). Potentially a live option.
 #define TRANSIENTVOLUME // Display volume only transient, when changed
+#define VU_SEGMENT_PITCH 0  // VU bar segments: 0 for solid bars, or the pitch (lit pixels + 1 gap), e.g. 4
+
+// Minimum time (ms) between display frames. Changes made between frames are sent together,
+// and nothing is sent when nothing has changed.
+#define FRAME_INTERVAL  40
+
+// Display controller size in 8x8 tiles, unrotated: the SH1107 64x128 declared in AmpController.ino
+// is 8 tiles across and 16 down (U8G2_R1 turns it to 128x64 on screen). Sizes the tile buffers.
+#define DISPLAY_TILE_WIDTH  8
+#define DISPLAY_TILE_HEIGHT 16
+
+// Tiles sent to the display per task() step. Each tile (8 bytes on I2C) takes ~0.3 ms,
+// so this bounds how long a refresh holds up the main loop.
+#define FLUSH_TILES     2
 
 // Font choices
 #define VOL_PCT_FONT    u8g2_font_helvR24_tr
@@ -45,6 +61,14 @@ constexpr areaSpec_t volLabArea =       {101, 127, 20, 48, false};
 constexpr areaSpec_t wholeVolumeArea =  {  0, 127, 20, 48, false};
 constexpr areaSpec_t messageArea =      {  0, 127, 53, 63, false};
 
+// Glyph cache: glyphs are rendered once by U8g2 and then copied into the buffer row by row.
+// Sized for the fonts above; larger glyphs are drawn by U8g2 as usual. 16 entries hold the volume
+// in dB (digits, minus and point, and the "dB" label) with room to spare; other text is re-rendered
+// as it evicts them. Text longer than the cache is drawn by U8g2.
+#define GLYPH_CACHE_SIZE    16
+#define MAX_GLYPH_ROWS      40      // Font bounding box height
+#define MAX_GLYPH_WIDTH     32
+
 class AmpDisplay {
 
 protected:
@@ -55,15 +79,86 @@ protected:
 
     // State - supports updates only when necessary
     uint8_t muteState {3};                      // Muted? 0 = no; 1 = yes; 3 = undetermined
-    float volumeState {-129};                   // dB.  Can be set below MIN_VOLUME to denote as-yet-undetermined.
+    int16_t volumeState {-1};                   // MiniDSP units (-0.5 dB), or -1 while as-yet-undetermined.
     source_t sourceState {source_t::Unset};     // Current source. 
     bool dimState {false};                              // True if dimmed.
     uint32_t brightTime {false};                        // Time when dim timer was reset
+    bool autoDim {false};                               // Dim after the dim time, checked at each frame tick
+
+    // Contrast fade, advanced at each frame tick. Levels are brightness (as in contrast()) in 1/256ths.
+    uint16_t fadeLevel {8 << 8};                // Where the fade is now; U8g2 starts the SH1107 near full
+    uint16_t fadeFrom {0};
+    uint16_t fadeTarget {0};
+    uint32_t fadeStart {0};
+    uint16_t fadeTime {0};
+    bool fading {false};
+    int16_t sentContrast {-1};                  // Contrast last sent, or -1 if something else may have set it
     bool volumeShown {false};                   // Enables selective re-draw of volume in display wakeup 
 
     bool newContent {false};
     bool autoRefresh {false};
 
+    // Tiles (8x8 pixels) changed since the last refresh, in the controller's own unrotated tile grid:
+    // one word per tile row, one bit per tile column. A display with a larger grid is only partly sent.
+    static constexpr uint8_t maxTileRows = DISPLAY_TILE_HEIGHT;
+    static constexpr uint8_t maxTileColumns = DISPLAY_TILE_WIDTH;
+    static_assert(maxTileColumns <= 16, "Tile columns must fit the bits of a dirtyTiles word");
+    static constexpr uint16_t allTileColumns = (1UL << maxTileColumns) - 1;
+    uint16_t dirtyTiles[maxTileRows] {};
+
+    // The frame being sent: a copy of its changed tiles, so drawing can carry on in the U8G2 buffer,
+    // and the tiles still to go.
+    uint8_t frameTiles[maxTileRows][maxTileColumns][8];
+    uint16_t sendingTiles[maxTileRows] {};
+    uint8_t sendRow {0};
+    bool sending {false};
+    bool refreshPending {false};                // refresh() was called since the last frame started
+    uint32_t frameTime {0};                     // millis() at the last frame tick
+    uint16_t frameInterval {FRAME_INTERVAL};
+
+    // Rendered glyphs, keyed by font and character. Labels are made of cached glyphs too, so editing
+    // a label in the options never leaves anything stale.
+    struct CachedGlyph {
+        const uint8_t * font {nullptr};
+        uint8_t encoding {0};
+        int8_t advance {0};                     // U8g2 delta x, to the next glyph
+        uint8_t inkWidth {0};                   // Glyph width + x offset, which U8g2 uses for the width of the last glyph
+        int8_t left {0};                        // First column, relative to the cursor
+        uint8_t width {0};                      // Columns stored
+        int8_t top {0};                         // First row, relative to the baseline
+        uint8_t height {0};
+        uint16_t lastUse {0};
+        bool solid {false};                     // Solid font mode: U8g2 also clears the background in the box below
+        uint8_t boxTop {0};                     // Rows of the box, relative to top
+        uint8_t boxHeight {0};
+        uint32_t boxColumns {0};                // Columns of the box, as a row mask
+        uint32_t ink[MAX_GLYPH_ROWS];           // One bit per column, LSB first: pixels set
+
+        // Pixels U8g2 writes in a row: the ink, plus the box in solid font mode
+        uint32_t mask(uint8_t row) const {
+            return (solid && row >= boxTop && row < boxTop + boxHeight) ? ink[row] | boxColumns : ink[row];
+        }
+    };
+    CachedGlyph glyphCache[GLYPH_CACHE_SIZE];
+    uint16_t glyphUseCount {0};
+    bool textCacheEnabled {true};
+
+    // Bar graph as last drawn, so that only the change needs drawing. Anything else drawn over it clears barsShown.
+    bool barsShown {false};
+    areaSpec_t barArea {};
+    uint8_t barLeftWidth {0};
+    uint8_t barRightWidth {0};
+    uint8_t barLeftMarker {0};                  // Peak marker column + 1 (counted from the center), or 0 if none shown
+    uint8_t barRightMarker {0};
+    uint8_t barSegmentPitch {VU_SEGMENT_PITCH};
+    uint16_t barPixels {0};                     // Pixels written by the last bar graph update
+
+    // Cost of the last refresh, for tuning the update interval
+    uint32_t frameStall {0};
+    uint8_t frameTileCount {0};
+    uint32_t refreshMicros {0};
+    uint8_t refreshTiles {0};
+
 public:
 
     // Constructor
@@ -71,7 +166,7 @@ public:
     {
         display = u8g2;
         muteState = 3;
-        volumeState = -129;
+        volumeState = -1;
         sourceState = source_t::Unset;
         dimState = false;
         brightTime = millis();
@@ -80,7 +175,7 @@ public:
         autoRefresh = false;
     }
 
-    AmpDisplay(U8G2 * u8g2, float vol, bool mute, source_t input, bool dB)
+    AmpDisplay(U8G2 * u8g2, uint8_t vol, bool mute, source_t input, bool dB)
     {
         display = u8g2;
         dBDisplay = dB;
@@ -89,9 +184,9 @@ public:
         volumeState = vol;
     }
     
-    // @brief Display volume, in % or dB.
+    // @brief Display volume, in % or dB. The volume is in MiniDSP units (-0.5 dB), as the MiniDSP reports it.
     // This updates the volume state and as needed updates and wakes the display
-    void volume(float vol);
+    void volume(uint8_t vol);
 
     // @brief Display mode - sets volume display for % or dB
     void volumeMode(bool dB);
@@ -111,10 +206,17 @@ public:
     // @brief Set max volume for % mode
     void setMaxVolume(float max);
 
-    // @brief See if anything needs to be done (dim, return to default, etc.)
-    // NOT IMPLEMENTED - CURRENTLY, THINGS LIKE DIMMING ARE DONE BY THE APPLICATION
+    /**
+     * @brief Send the next few tiles of a frame in progress (at most FLUSH_TILES). Otherwise, once per
+     * frame interval while there is anything to do: check the dim timer, advance a contrast fade, and
+     * start the next frame if a refresh has been requested. Call on every pass of the main loop;
+     * with nothing to do it returns at once.
+     */
     void task();
 
+    // @brief Set the minimum time (ms) between frames, which is also the contrast fade step
+    void setFrameInterval(uint16_t interval);
+
     // @brief Draw the display background
     // Draws any dividers, etc. that persist
     void drawFrame();
@@ -125,28 +227,41 @@ public:
     // @brief Display a text string in the selected area
     void displayMessage(const char * message, areaSpec_t area);
 
-    // @brief Bar graph in the specified area
-    // Levels are integer percent of full width
-    void displayLRBarGraph(uint8_t leftLevel, uint8_t rightLevel, areaSpec_t area);
+    // @brief Bar graph in the specified area, with optional peak markers
+    // Levels are integer percent of full width. A marker is shown where its level is beyond the end of the bar.
+    // Only the columns that changed since the last call are drawn.
+    void displayLRBarGraph(uint8_t leftLevel, uint8_t rightLevel, areaSpec_t area, uint8_t leftPeak = 0, uint8_t rightPeak = 0);
+
+    // @brief Draw the bar graph in segments of (pitch - 1) pixels with 1 pixel gaps, or solid if pitch is 0
+    void setBarSegments(uint8_t pitch);
+
+    // @brief Pixels written by the last bar graph update
+    uint16_t lastBarPixels() const { return barPixels; }
 
     // @brief Reset the dimming timer
     void scheduleDim();
 
-    // @brief Check the dimming timer and dim if needed
-    void checkDim();
+    /**
+     * @brief Enable or disable dimming after the dim time. Disabling also stops any fade, and forgets
+     * the contrast sent, so that code given the display can set the contrast itself.
+     */
+    void setAutoDim(bool enable);
 
-    // @brief Dim the display
+    // @brief Dim the display, fading down
     void dim();
 
     // @brief Check if the display is dimmed
     bool dimmed();
 
-    // @brief Un-dim the display, without restoring the volume indicator, or scheduling dimming
+    // @brief Un-dim the display (fading up), without restoring the volume indicator, or scheduling dimming
     void undim();
 
     // @brief Wake up the display, restoring the volume indicator as needed and scheduling dimming
     void wakeup();
 
+    // @brief True while the contrast is fading
+    bool fadeActive() const { return fading; }
+
     // @brief Cue a pending long press
     void cueLongPress();
 
@@ -165,18 +280,43 @@ public:
     void setImmediateUpdate(bool immediate);
 
     /**
-     * @brief Refresh the display if needed, by sending the draw buffer to the display.
+     * @brief Refresh the display if needed. At the next frame time, task() copies the changed part
+     * of the draw buffer and then sends it a few tiles at a time, so this returns at once.
      */
     void refresh();
 
+    /**
+     * @brief Refresh the display if needed and wait until it has all been sent. For use before
+     * blocking, or before handing the display to code that draws to it directly.
+     */
+    void flush();
+
+    /**
+     * @brief Mark the whole screen as changed, so the next refresh sends the entire buffer.
+     * Use after drawing to the U8G2 buffer directly rather than through this class.
+     */
+    void invalidate();
+
+    // @brief Enable or disable the glyph cache (for comparison; it is on by default)
+    void useTextCache(bool enable);
+
+    /**
+     * @brief Time redraws of the volume indicator, as during a knob spin. The screen is redrawn
+     * afterwards.
+     *
+     * @param steps Number of 0.5 dB steps to draw
+     * @return Mean time per redraw, in us
+     */
+    uint32_t benchmarkVolume(uint16_t steps);
+
+    // @brief Longest time (us) a single step of the last refresh held up the caller, and the tiles it sent
+    uint32_t lastRefreshMicros() const { return refreshMicros; }
+    uint8_t lastRefreshTiles() const { return refreshTiles; }
+
 private:
 
     Options & ampOptions = Options::instance();      // Access the options store
 
-    // These are the max and min in dB that can be set in the minidsp
-    const uint8_t MAX_VOLUME = 0; 
-    const uint8_t MIN_VOLUME = -128;
-
     // @brief Display a text string in a specified area
     void displayText(const char * text, const uint8_t * font,  areaSpec_t area, const bool erase, const uint8_t offset = 0);
 
@@ -202,4 +342,47 @@ private:
      * to the display, or note that refresh() needs to do so when called.
      */
     void displayUpdate();
+
+    // @brief Draw text from the glyph cache, rendering any glyphs not yet cached.
+    // Returns false, without drawing, if the display layout or the text isn't supported.
+    bool drawCachedText(const char * text, areaSpec_t area, int16_t baseline, int16_t & textXL, int16_t & textWidth);
+
+    // @brief Find a glyph of the current font in the cache, rendering it if not there
+    CachedGlyph * cachedGlyph(const uint8_t * font, uint8_t encoding);
+
+    // @brief Write (the masked pixels) or read up to 32 pixels of a row directly in the U8G2_R1 buffer.
+    // The LSB is the leftmost pixel.
+    void writeRow(int16_t x, int16_t y, uint8_t width, uint32_t bits, uint32_t mask = 0xFFFFFFFF);
+    uint32_t readRow(int16_t x, int16_t y, uint8_t width);
+
+    /**
+     * @brief Draw or erase part of one bar of the bar graph, marking it dirty
+     *
+     * @param from First column, as distance from the center gap
+     * @param to Column after the last
+     * @param on Draw (honoring segments) or erase
+     */
+    void drawBarSpan(bool leftBar, uint8_t from, uint8_t to, bool on);
+
+    // @brief Draw or erase the one-column peak marker of a bar, at the given distance from the center
+    void drawBarMarker(bool leftBar, uint8_t column, bool on);
+
+    // @brief Note that something other than the bar graph was drawn in the area
+    void coverBars(areaSpec_t area);
+
+    // @brief Note that the given area (pixels, inclusive) has changed and must be sent at the next refresh
+    void markDirty(int16_t XL, int16_t YT, int16_t XR, int16_t YB);
+    void markDirty(areaSpec_t area) { markDirty(area.XL, area.YT, area.XR, area.YB); }
+
+    // @brief Copy the changed tiles and start sending them
+    void startFrame();
+
+    // @brief Fade the contrast to the given brightness (as in contrast()) over time ms, from wherever it is now
+    void startFade(uint8_t brightness, uint16_t time);
+
+    // @brief Move the fade on to the given time and send the contrast if it has changed
+    void stepFade(uint32_t now);
+
+    // @brief Send up to maxTiles tiles of the frame in progress, one run of adjacent tiles at a time
+    void sendTiles(uint16_t maxTiles);
 };
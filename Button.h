@@ -44,6 +44,12 @@ public:
      */
     uint32_t closedFor();
 
+    /**
+     * @brief Check that the switch is open and has been since the last debounce
+     * @return true if open and settled
+     */
+    bool settledOpen() { return !lastContactState && !validatedState; }
+
 protected:
     bool validatedState;            // Current validated state
     uint32_t currentTime;
@@ -110,6 +116,12 @@ public:
      */
     buttonEvent_t Task();
 
+    /**
+     * @brief Check that nothing is going on: released, and no press or release still to be reported
+     * @return true if idle
+     */
+    bool idle() { return buttonState == RELEASED && settledOpen(); }
+
 
 private:
 
@@ -37,4 +37,22 @@ const char VERSION[] {"1.0.0"};
 #define UHS_SS  1   // Labeled RX
 #define UHS_INT 0   // Labeled TX
 
+// Number of MiniDSPs (1 or 2). A second unit (e.g. subs) needs a USB hub on the
+// host shield; volume, mute, source, gain and preset changes go to both.
+#define MINIDSP_UNITS 1
 
+
+
+// 1: run the USB host stack and the MiniDSPs in a FreeRTOS task of their own, and the display flush in
+// another, so that the state machine, remote and knob never wait on the USB or I2C bus.
+// 0: everything runs from loop().
+#define RTOS_TASKS 0
+
+// 1: time each poll, task and event handler in CPU cycles (Probes.h), and print the table when 'p' is
+// sent on Serial ('r' resets it); about 3 KB of RAM. 0: no probes, no tables, no cost.
+#define TIMING_PROBES 0
+
+// Bytes of RAM for the stimulus log (StimulusLog.h): the remote, knob, button, trigger and input level
+// changes the controller acted on, dumped as hex when 'l' is sent on Serial, for tools/replay_host.
+// 0: no log, no recording; 8192, say, to record a session.
+#define STIMULUS_LOG 0
@@ -0,0 +1,38 @@
+// Commands for the MiniDSPs and the USB host. The state machine issues them through dspCommand(),
+// which runs them at once, or with RTOS_TASKS queues them for the USB task, the only task that
+// touches the USB stack.
+
+#pragma once
+
+#include <Arduino.h>
+#include "src/UHS/MiniDSP.h"
+
+enum class dspCommand_t : uint8_t {
+    SetVolume,
+    SetMute,
+    SetSource,
+    SetInputGain,
+    SetPreset,
+    RequestVolume,
+    RequestMute,
+    RequestSource,
+    RequestPreset,
+    RequestInputLevels,
+    RequestStatus,      // Source, volume and mute, in one read
+    ResetUSB,           // Poll the host shield, and re-init it if something's still attached
+    StartRecovery,      // Start USB recovery, waiting for the MiniDSPs to enumerate
+    RestartUSB,         // Re-init the host shield after a power cycle or standby
+    PowerDownUSB        // Stop the host shield's oscillator, for standby
+};
+
+struct DSPCommand {
+    dspCommand_t type;
+    uint16_t seq;               // With RTOS_TASKS, its number in the queue
+    uint32_t time;              // micros() when the event that led to it was posted (or when issued, if none)
+    union {
+        uint8_t value;          // SetVolume, SetPreset
+        bool flag;              // SetMute
+        source_t source;        // SetSource
+        float gain;             // SetInputGain
+    };
+};
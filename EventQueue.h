@@ -0,0 +1,102 @@
+// Events for the amp state machine, and a fixed-size queue to hold them.
+// Hardware callbacks (USB, button, knob, remote, triggers, menu) post events; the main loop
+// dispatches them once per pass, in order, each running to completion. So no state handler, and
+// no onEntry(), runs inside another module's task.
+// Everything posts from the main loop (callbacks are made from the modules' tasks, not from
+// interrupts), so the queue itself does no locking. With RTOS_TASKS the USB task posts too, and
+// AmpController.ino locks around the queue.
+
+#pragma once
+
+#include <Arduino.h>
+#include "src/UHS/MiniDSP.h"
+#include "InputSensing.h"
+
+enum class ampEvent_t : uint8_t {
+    DSPConnected,
+    DSPTimeout,
+    DSPLost,
+    DSPVolume,
+    DSPMute,
+    DSPSource,
+    DSPPreset,
+    DSPInputLevels,
+    DSPInputGains,
+    ButtonShortPress,
+    ButtonLongPressPending,
+    ButtonLongPress,
+    ButtonFullHold,
+    KnobTurned,
+    RemoteVolPlus,
+    RemoteVolMinus,
+    RemoteMute,
+    RemoteSource,
+    RemotePower,
+    RemotePreset,
+    TriggerRise,
+    TriggerFall,
+    Silence,
+    MenuExit,
+    Count
+};
+
+constexpr const char * ampEventNames[] {
+    "DSPConnected", "DSPTimeout", "DSPLost", "DSPVolume", "DSPMute", "DSPSource", "DSPPreset", "DSPInputLevels",
+    "DSPInputGains", "ButtonShortPress", "ButtonLongPressPending", "ButtonLongPress", "ButtonFullHold",
+    "KnobTurned", "RemoteVolPlus", "RemoteVolMinus", "RemoteMute", "RemoteSource", "RemotePower",
+    "RemotePreset", "TriggerRise", "TriggerFall", "Silence", "MenuExit"
+};
+static_assert(sizeof(ampEventNames) / sizeof(ampEventNames[0]) == (uint8_t)ampEvent_t::Count, "A name for each event");
+
+struct AmpEvent {
+    ampEvent_t type;
+    uint32_t time;              // micros() when posted
+    union {
+        uint8_t value;          // DSPVolume, DSPPreset
+        bool flag;              // DSPMute
+        source_t source;        // DSPSource
+        int8_t change;          // KnobTurned
+        trigger_t triggers;     // TriggerRise, TriggerFall
+        float levels[2];        // DSPInputLevels, DSPInputGains (copied; the MiniDSP reuses its buffer)
+    };
+};
+
+// A ring of up to size items. When full, post() drops the new item and counts it.
+template <class T, uint8_t size> class EventQueue {
+
+    public:
+        // @brief Add an item at the back. Returns false, and drops it, if the queue is full.
+        bool post(const T & item) {
+            if (_count == size) {
+                _dropped++;
+                return false;
+            }
+            _items[(_head + _count) % size] = item;
+            _count++;
+            _maxDepth = max(_maxDepth, _count);
+            return true;
+        }
+
+        // @brief Take the item at the front. Returns false if the queue is empty.
+        bool next(T & item) {
+            if (!_count) return false;
+            item = _items[_head];
+            _head = (_head + 1) % size;
+            _count--;
+            return true;
+        }
+
+        // @brief Items waiting, the most there have been, and items dropped because the queue was full
+        uint8_t depth() const { return _count; }
+        uint8_t maxDepth() const { return _maxDepth; }
+        uint16_t dropped() const { return _dropped; }
+
+        void clear() { _head = _count = 0; }
+
+    private:
+        T _items[size];
+        uint8_t _head {0};
+        uint8_t _count {0};
+        uint8_t _maxDepth {0};
+        uint16_t _dropped {0};
+};
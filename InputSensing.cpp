@@ -38,8 +38,10 @@ void TriggerSensing::begin() {
 
 trigger_t TriggerSensing::update() {
     lastTriggers = triggers;
-    triggers = {analogTrigger.next(filteredAnalog.next(analogRead(ANALOG_TRIGGER_PIN))),
-                digitalTrigger.next(filteredDigital.next(analogRead(DIGITAL_TRIGGER_PIN)))};
+    _analogSample = analogRead(ANALOG_TRIGGER_PIN);
+    _digitalSample = analogRead(DIGITAL_TRIGGER_PIN);
+    triggers = {analogTrigger.next(filteredAnalog.next(_analogSample)),
+                digitalTrigger.next(filteredDigital.next(_digitalSample))};
     return triggers;
 }
 
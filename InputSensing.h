@@ -34,6 +34,7 @@ extern void onSilence();
 //const int dTrigger = FIRCoeff(0.1, 0.050) * 100;
 
 constexpr float dTrigger = 0.135;   // tau = 0.1 Hz, samplePeriod = 50 ms
+constexpr uint16_t triggerSamplePeriod = 50;   // ms, the rate TriggerSensing::task() should be called at
 
 // Single pole IIR filter
 template <class T> class IIR {
@@ -156,6 +157,10 @@ class TriggerSensing {
         // @brief Current trigger state
         trigger_t getTriggers() { return triggers; };
 
+        // @brief The last raw ADC samples, before filtering
+        uint16_t analogSample() const { return _analogSample; }
+        uint16_t digitalSample() const { return _digitalSample; }
+
     private:
         IIIR filteredAnalog {filteredInput0};   // Quiet any bumps in the inputs
         IIIR filteredDigital {filteredInput0};
@@ -165,6 +170,9 @@ class TriggerSensing {
 
         trigger_t triggers {false, false};
         trigger_t lastTriggers {false, false};
+
+        uint16_t _analogSample {0};
+        uint16_t _digitalSample {0};
 };
 
 constexpr uint32_t oneMinute = 60000; // ms
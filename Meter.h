@@ -0,0 +1,92 @@
+// Level meter engine for the VU display: levels in dB, held in fixed point, with the meter
+// ballistics chosen at compile time by a policy class.
+
+#pragma once
+
+#include <Arduino.h>
+
+// Levels are dB in Q8 (1/256 dB), so a step of the MiniDSP volume (0.5 dB) is 128
+typedef int32_t level_t;
+
+inline level_t dBLevel(float dB) { return static_cast<level_t>(dB * 256); }
+inline float levelDB(level_t level) { return level / 256.0f; }
+
+// exp(-i/8) in Q15, i = 0..64
+constexpr uint16_t expTable[65] {
+    32768, 28918, 25520, 22521, 19875, 17539, 15479, 13660, 12055,
+    10638,  9388,  8285,  7312,  6452,  5694,  5025,  4435,  3914,
+     3454,  3048,  2690,  2374,  2095,  1849,  1631,  1440,  1271,
+     1121,   990,   873,   771,   680,   600,   530,   467,   412,
+      364,   321,   283,   250,   221,   195,   172,   152,   134,
+      118,   104,    92,    81,    72,    63,    56,    49,    43,
+       38,    34,    30,    26,    23,    21,    18,    16,    14,
+       12,    11
+};
+
+// exp(-x/2048) in Q15, interpolated from the table
+constexpr int32_t expQ15(uint32_t x) {
+    return x >= 64 * 256 ? 0 : expTable[x >> 8] - (((expTable[x >> 8] - expTable[(x >> 8) + 1]) * int32_t(x & 255)) >> 8);
+}
+
+// @brief Coefficient (Q15) of a single pole filter with time constant tau (ms) at a sample interval of dt (ms):
+// 1 - exp(-dt/tau). The meters run at a fixed interval, so this is evaluated at compile time.
+constexpr int32_t meterCoeff(uint32_t tau, uint32_t dt) { return 32768 - expQ15(dt * 2048 / tau); }
+
+// Ballistics policies. Each has a State (whatever it needs between samples) and
+//   template <uint16_t dt> static level_t next(State & state, level_t level, level_t input)
+// which returns the new meter level given the current one and the input, with inputs dt ms apart.
+
+// Standard VU meter: 90% of a step in 300 ms, rising and falling
+struct VUBallistics {
+    struct State {};
+    template <uint16_t dt> static level_t next(State &, level_t level, level_t input) {
+        constexpr int32_t coeff = meterCoeff(130, dt);
+        return level + (((input - level) * coeff) >> 15);
+    }
+};
+
+// Peak programme meter (IEC 60268-10 type II): 10 ms integration, falls 24 dB in 2.8 s
+struct PPMBallistics {
+    struct State {};
+    template <uint16_t dt> static level_t next(State &, level_t level, level_t input) {
+        constexpr int32_t attack = meterCoeff(10, dt);
+        constexpr level_t release = 24 * 256 * 10 * dt / 28000;
+        if (input > level) return level + (((input - level) * attack) >> 15);
+        return max(input, level - release);
+    }
+};
+
+// Peak hold: follows peaks at once, holds them for holdTime (ms), then falls at releaseRate (dB/s).
+// Rather than count out the hold, a ceiling set above each peak by the fall over holdTime falls from
+// the start, and the meter reads the lower of the two. No branch on the input, which rises above the
+// held level at random.
+template <uint16_t holdTime = 1500, uint16_t releaseRate = 20> struct PeakHoldBallistics {
+    struct State {
+        level_t ceiling {0};
+    };
+    template <uint16_t dt> static level_t next(State & state, level_t level, level_t input) {
+        constexpr level_t release = (level_t)releaseRate * 256 * dt / 1000;
+        state.ceiling = input >= level ? input + release * (holdTime / dt) : state.ceiling - release;
+        return max(input, min(level, state.ceiling));
+    }
+};
+
+// A meter channel with the given ballistics, taking an input every interval ms and starting at the given level.
+// Inputs should not go below that level (the signal floor), which keeps the peak hold ceiling in range.
+template <class Ballistics, uint16_t interval> class Meter {
+
+    public:
+        explicit Meter(level_t initial) : _level{initial} {}
+
+        // @brief Takes an input level and returns the meter level
+        level_t next(level_t input) {
+            return _level = Ballistics::template next<interval>(_state, _level, input);
+        }
+
+        // @brief Returns the current meter level
+        level_t level() const { return _level; }
+
+    private:
+        level_t _level;
+        typename Ballistics::State _state;
+};
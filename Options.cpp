@@ -116,4 +116,23 @@ bool Options::save() {
         error |= (result < 0);
     }
     return error;
+}
+
+uint16_t Options::size() const {
+    uint16_t total = 0;
+    for (const writableOption_t & option : optionTable) total += option.size;
+    return total;
+}
+
+void Options::write(Print & out) const {
+    for (const writableOption_t & option : optionTable) out.write((const uint8_t *)option.value, option.size);
+}
+
+bool Options::read(const uint8_t * snapshot, uint16_t length) {
+    if (length != size()) return false;
+    for (const writableOption_t & option : optionTable) {
+        memcpy(option.value, snapshot, option.size);
+        snapshot += option.size;
+    }
+    return true;
 }
\ No newline at end of file
@@ -103,6 +103,10 @@ class Options {
         // Auto-off time, in minutes. 
         uint8_t autoOffTime = 30;  
 
+        // Warm standby time, in minutes: how long the amp stays muted with the MiniDSP powered after
+        // the input goes, before turning off. 0 turns off at once.
+        uint8_t warmStandbyTime = 10;
+
         // Definition of silence - low enough to be inaudible; high enough to accomodate any noise from the analog source
         uint8_t silence = 140; // -70.0 dB
 
@@ -140,7 +144,7 @@ class Options {
         // To add a variable to nonvolatile storage, add it here.
         // There is no cleanup of nonvolatile storage, so if a name is changed or an entry is removed,
         // there will be an orphaned file in the filesystem.
-        const writableOption_t optionTable[15] = {
+        const writableOption_t optionTable[16] = {
             {&maxVolume,               "Vol_max",   sizeof(maxVolume)},
             {&maxInitialVolume,        "Vol_init",  sizeof(maxInitialVolume)},
             {&analogDigitalDifference, "AD_diff",   sizeof(analogDigitalDifference)},
@@ -155,7 +159,8 @@ class Options {
             {&inputCmd,                "Input_cmd", sizeof(inputCmd)},
             {&powerCmd,                "Power_cmd", sizeof(powerCmd)},
             {&brightness,              "Brightness",sizeof(brightness)},
-            {&dimTime,                 "Dim_time",  sizeof(dimTime)}
+            {&dimTime,                 "Dim_time",  sizeof(dimTime)},
+            {&warmStandbyTime,         "Warm_stby", sizeof(warmStandbyTime)}
         };
 
         // The parameters are saved in a folder in the filesystem, just in case the device is used
@@ -198,6 +203,22 @@ class Options {
          */
         bool changed();
 
+        /**
+         * @brief Bytes in a snapshot of the values (write())
+         */
+        uint16_t size() const;
+
+        /**
+         * @brief Write a snapshot of the values, in table order, e.g. to go with a stimulus log
+         */
+        void write(Print & out) const;
+
+        /**
+         * @brief Take the values from a snapshot written by write()
+         * @return false, changing nothing, if the snapshot is not the size of this build's
+         */
+        bool read(const uint8_t * snapshot, uint16_t length);
+
 
     private:
         /**
@@ -24,12 +24,11 @@ namespace OptionsMenu {
     // Private utility functions and menu callbacks
 
     /**
-     * @brief Learn an IR code for the designated function
+     * @brief Start learning an IR code for the designated function. task() waits for the code.
      * 
      * @param cmd The command (enum to keep in sync with the remote handler)
-     * @return ArduinoMenu result (always proceed)
      */
-    uint32_t remoteLearn(remoteCommands command);
+    void remoteLearn(remoteCommands command);
 
     /// @brief Copy remote codes to the options store
     result saveRemoteCodesOp(eventMask event, prompt &item);
@@ -233,6 +232,7 @@ namespace OptionsMenu {
 
     altMENU(altTitle, autoOffMenu, "Auto off", setAutoOffVals, /*setupEntry, exitEvent*/ (eventMask)(enterEvent | exitEvent), noStyle, (Menu::_menuData|Menu::_canNav),
         altFIELD(offField, ampOptions.autoOffTime, "Auto off", " min", 0, 60, 5, 0, doNothing, noEvent, noStyle),
+        altFIELD(offField, ampOptions.warmStandbyTime, "Warm", " min", 0, 60, 5, 0, doNothing, noEvent, noStyle),
         altFIELD(decPlaces<1>::menuField, f_silence, "Level", " dB", -80, -30, 5, 0, doNothing, noEvent, noStyle),
         EXIT("<< BACK")
         );
@@ -488,20 +488,41 @@ namespace OptionsMenu {
         return proceed;
     }
 
-    void u8g2Confirm(const char * text, uint16_t duration) {
+    // A message or a remote code being learned holds the menu across task() calls, rather than
+    // delaying, so the loop carries on. Meanwhile the menu takes no input and isn't redrawn.
+    uint32_t holdStart {0};
+    uint16_t holdTime {0};              // ms the message stays up; 0 when there's none
+    void (*afterHold)() {nullptr};      // Then done by task()
+
+    constexpr uint16_t learnTimeout {5000};     // ms to wait for a remote button press
+    bool learning {false};
+    remoteCommands learnItem;
+    uint32_t learnStart;
+    uint32_t learnedCommand;
+
+    bool busy() { return learning || holdTime; }
+
+    void hold(uint16_t duration, void (*then)()) {
+        holdStart = millis();
+        holdTime = duration;
+        afterHold = then;
+    }
+
+    void u8g2Confirm(const char * text, uint16_t duration, void (*then)() = nullptr) {
         display.clear();
         display.setDrawColor(1);
         display.setCursor(0, (U8_Height + fontY)/2);
         display.print(text);
         display.updateDisplay();
-        delay(duration);
+        hold(duration, then);
     }
 
     void saveValues() {
         ampOptions.save();
-        u8g2Confirm("Saved options.", 3000);
-        ampSetup.edits(false);
-        nav.doNav(downCmd);
+        u8g2Confirm("Saved options.", 3000, [] {
+            ampSetup.edits(false);
+            nav.doNav(downCmd);
+        });
     }
 
     result saveRemoteCodesOp(eventMask event, prompt &item) {
@@ -520,7 +541,7 @@ namespace OptionsMenu {
     //          - Should that be done here, or at the end of the menu?
     //          - If the latter, it could be done in the remote handler - as converse of load()
 
-    uint32_t remoteLearn(remoteCommands cmd) {
+    void remoteLearn(remoteCommands cmd) {
         display.clear();
         display.setDrawColor(1);
         display.setCursor(0, fontY);
@@ -529,23 +550,32 @@ namespace OptionsMenu {
         display.println("Press a button...");
         display.updateDisplay();
 
-        uint32_t command = ourRemote.getRawCommand(5000);
+        ourRemote.startRawCommand();
+        learning = true;
+        learnItem = cmd;
+        learnStart = millis();
+    }
+
+    // Called by task() while learning: show the code once it comes, or the timeout
+    void learnTask() {
+        uint32_t command = 0;
+        if (!ourRemote.rawCommand(command) && (millis() - learnStart) <= learnTimeout) return;
+        learning = false;
+        learnedCommand = command;
 
         display.setCursor(0, 3 * fontY);
         if (command) {
             display.printf("Got %0X", command);
-            ourRemote.set(cmd, command);
+            ourRemote.set(learnItem, command);
         } else {
             display.println("Timeout");
         }
         display.updateDisplay();
-        delay(2000);
 
-        nav.doNav(upCmd);                   // Next item (with buttons, up is down);
-        if (!command) nav.doNav(downCmd);   // ... or position for a retry
-        //nav.idleOn();                     // Alt force redraw
-        //nav.idleOff();
-        return proceed;
+        hold(2000, [] {
+            nav.doNav(upCmd);                           // Next item (with buttons, up is down);
+            if (!learnedCommand) nav.doNav(downCmd);    // ... or position for a retry
+        });
     }
 
     result quitRemoteOp(eventMask event, prompt &item) {
@@ -589,7 +619,16 @@ namespace OptionsMenu {
         }
 
     void task() {
-        bool changed;
+        if (learning) {
+            learnTask();
+            return;
+        }
+        if (holdTime) {
+            if ((millis() - holdStart) < holdTime) return;
+            holdTime = 0;
+            nav.refresh();              // Redraw over the message
+            if (afterHold) afterHold();
+        }
         if (nav.changed(0)) {
             nav.doOutput();
             display.updateDisplay();
@@ -597,9 +636,13 @@ namespace OptionsMenu {
         if (nav.sleepTask) onMenuExit();
     }
 
-    void cursorUp() { nav.doNav(upCmd); }
-    void cursorDown() { nav.doNav(downCmd); }
-    void enter() { nav.doNav(enterCmd); }
-    void reset() { nav.reset(); }
+    void cursorUp() { if (!busy()) nav.doNav(upCmd); }
+    void cursorDown() { if (!busy()) nav.doNav(downCmd); }
+    void enter() { if (!busy()) nav.doNav(enterCmd); }
+    void reset() {
+        learning = false;
+        holdTime = 0;
+        nav.reset();
+    }
 
 }
\ No newline at end of file
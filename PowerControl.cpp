@@ -10,8 +10,6 @@ void turnOn()       { digitalWrite(RELAY_PIN, HIGH); }
 void disable()      { digitalWrite(AMP_ENABLE_PIN, HIGH); }
 void enable()       { digitalWrite(AMP_ENABLE_PIN, LOW); }
 
-void limitedDelay(uint32_t ms, uint32_t max) { delay(ms > max ? max : ms ); }
-
 PowerControl::PowerControl() {}
 
 void PowerControl::begin() {
@@ -26,6 +24,7 @@ void PowerControl::begin() {
     }
 
 void PowerControl::powerOn() { 
+    offPending = false;
     if (powerIsOn()) return;
     if (ampsEnabled()) ampDisable();  // We assume it's OK to power on immediately with EN low
     turnOn(); 
@@ -33,22 +32,34 @@ void PowerControl::powerOn() {
     }
 
 void PowerControl::powerOff() { 
+    enablePending = false;
     if (!powerIsOn()) return;
-    if (ampsEnabled) ampDisable();
-    uint32_t howLong = millis() - whenDisabled;
-    if (howLong < enableDelay) limitedDelay(enableDelay - howLong, enableDelay);
-    turnOff(); 
+    if (ampsEnabled()) ampDisable();
+    offPending = true;
+    task();
     }
 
 void PowerControl::ampEnable() { 
     if (ampsEnabled()) return;
-    uint32_t howLong = millis() - whenPowerOn;
-    if (howLong < powerOnDelay) limitedDelay(powerOnDelay - howLong, powerOnDelay);
-    enable(); 
+    enablePending = true;
+    task();
     }
 
 void PowerControl::ampDisable() { 
+    enablePending = false;
     if (!ampsEnabled()) return;
     disable(); 
     whenDisabled = millis();
     }
+
+void PowerControl::task() {
+    uint32_t currentTime = millis();
+    if (offPending && (currentTime - whenDisabled) >= enableDelay) {
+        turnOff();
+        offPending = false;
+        }
+    if (enablePending && (currentTime - whenPowerOn) >= powerOnDelay) {
+        enable();
+        enablePending = false;
+        }
+    }
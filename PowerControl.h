@@ -19,25 +19,37 @@ class PowerControl {
         void powerOn();
 
         /**
-         * @brief Power off the DSP and amps. As necessary, disables the amps first,
-         * and waits for the disable to take effect.
+         * @brief Power off the DSP and amps. As necessary, disables the amps first; the relay
+         * opens (in task()) once the disable has taken effect.
          */
         void powerOff();
 
         /**
-         * @brief Enable the amps. As necessary, waits for powerup to finish first.
+         * @brief Enable the amps. The enable happens (in task()) once powerup has finished.
          */
         void ampEnable();
 
         /**
-         * @brief Disable the amps.
+         * @brief Disable the amps. Cancels an enable still waiting.
          */
         void ampDisable();
 
+        /**
+         * @brief Carry out a power off or an amp enable whose delay has passed. Call often.
+         */
+        void task();
+
+        /**
+         * @brief Nothing waiting on a delay
+         */
+        bool settled() const { return !offPending && !enablePending; }
+
     private:
         static const uint32_t powerOnDelay {1000};     // ms from line power to amps fully powered
         static const uint32_t enableDelay {100};       // ms from pulling EN down to amps quiet
 
         uint32_t whenPowerOn;
         uint32_t whenDisabled;
+        bool offPending {false};        // Relay to open once the amps have been disabled for enableDelay
+        bool enablePending {false};     // Amps to enable once powered for powerOnDelay
 };
\ No newline at end of file
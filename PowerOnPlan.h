@@ -0,0 +1,102 @@
+// Power-on planning and timing.
+// The plan times each phase of turning on, from the edge that started it (trigger rise, button or
+// remote) to the amps being enabled, for the last power-on and the slowest. From the MiniDSP's
+// enumeration on, it also keeps the volume and mute the MiniDSP reports (one status read returns the
+// source, volume and mute together), so the states that check them can decide as soon as they're
+// entered rather than asking again.
+
+#pragma once
+
+#include <Arduino.h>
+#include "EventQueue.h"
+
+enum class powerOnPhase_t : uint8_t {
+    RelayOn,
+    Enumerated,         // every MiniDSP has connected
+    SourceSet,
+    GainSet,
+    VolumeSet,
+    Unmuted,
+    AmpsEnabled,        // sound
+    Count
+};
+
+constexpr const char * powerOnPhaseNames[] {
+    "relay on", "enumerated", "source set", "gain set", "volume set", "unmuted", "amps enabled"
+};
+static_assert(sizeof(powerOnPhaseNames) / sizeof(powerOnPhaseNames[0]) == (uint8_t)powerOnPhase_t::Count, "A name for each phase");
+
+class PowerOnPlan {
+
+    public:
+        // @brief The edge (micros()): start timing from then
+        void start(uint32_t edge) {
+            _edge = edge;
+            _active = true;
+            _reached = 0;
+            _volumeKnown = _muteKnown = false;
+        }
+
+        // @brief Give up on this power-on (turned off part way), without counting it
+        void abandon() { _active = false; }
+
+        bool active() const { return _active; }
+
+        // @brief Record the time from the edge to the phase, the first time it's reached.
+        // Amps enabled completes the power-on; enumerated (again, after a power cycle) forgets what the MiniDSP said.
+        void reached(powerOnPhase_t phase) {
+            uint8_t p = (uint8_t)phase;
+            if (!_active) return;
+            if (phase == powerOnPhase_t::Enumerated) _volumeKnown = _muteKnown = false;     // Every time
+            if (_reached & (1 << p)) return;
+            _reached |= 1 << p;
+            _last[p] = (micros() - _edge) / 1000;
+            if (phase != powerOnPhase_t::AmpsEnabled) return;
+            for (uint8_t i = 0; i < (uint8_t)powerOnPhase_t::Count; i++) {
+                if (_reached & (1 << i)) _slowest[i] = max(_slowest[i], _last[i]);
+            }
+            _count++;
+            _active = false;
+        }
+
+        // @brief Note the volume or mute the MiniDSP reports, once it has enumerated
+        void note(const AmpEvent & event) {
+            if (!_active || !(_reached & (1 << (uint8_t)powerOnPhase_t::Enumerated))) return;
+            if (event.type == ampEvent_t::DSPVolume) {
+                _volume = event.value;
+                _volumeKnown = true;
+            }
+            if (event.type == ampEvent_t::DSPMute) {
+                _muted = event.flag;
+                _muteKnown = true;
+            }
+        }
+
+        bool volumeKnown() const { return _active && _volumeKnown; }
+        uint8_t volume() const { return _volume; }
+        bool muteKnown() const { return _active && _muteKnown; }
+        bool muted() const { return _muted; }
+
+        // @brief Print the ms from the edge to each phase, for the last (or current) power-on and the slowest
+        void print(Print & out) const {
+            out.printf("Power-on: %u completed%s\n", _count, _active ? ", one under way" : "");
+            out.printf("%-14s %8s %8s\n", "phase", "last ms", "max ms");
+            for (uint8_t i = 0; i < (uint8_t)powerOnPhase_t::Count; i++) {
+                if (_reached & (1 << i)) out.printf("%-14s %8lu %8lu\n", powerOnPhaseNames[i], _last[i], _slowest[i]);
+                else out.printf("%-14s %8s %8lu\n", powerOnPhaseNames[i], "-", _slowest[i]);
+            }
+        }
+
+    private:
+        uint32_t _edge {0};
+        bool _active {false};
+        uint8_t _reached {0};               // Bit for each phase reached in the last power-on
+        uint32_t _last[(uint8_t)powerOnPhase_t::Count] {};      // ms from the edge
+        uint32_t _slowest[(uint8_t)powerOnPhase_t::Count] {};
+        uint16_t _count {0};
+
+        bool _volumeKnown {false};
+        uint8_t _volume {0};
+        bool _muteKnown {false};
+        bool _muted {false};
+};
@@ -0,0 +1,158 @@
+// Timing probes: CPU cycles (the DWT cycle counter) spent in each poll, task and event handler, with
+// the count, min, mean, 99th percentile and max of each, for finding what holds up the loop.
+// A probe times the rest of the block it's in: PROBE(USB) at the top of a function times the function.
+// Probes nest, so the whole pass and the state's polls include the USB, remote, knob... probes inside them.
+// With RTOS_TASKS the times in the USB and display tasks include any time they were switched out.
+// TIMING_PROBES (Configuration.h) 0 removes the probes, the tables and the console command entirely.
+
+#pragma once
+
+#include <Arduino.h>
+#include "Configuration.h"
+#include "EventQueue.h"
+#ifdef UHS_HOST_MODEL
+#include <chrono>
+#endif
+
+enum class probe_t : uint8_t {
+    Pass,           // a whole scheduler pass
+    State,          // the state's polls
+    Events,         // event dispatch, all handlers
+    Triggers,
+    Power,          // relay and amp enable delays
+    Requests,
+    Display,
+    USB,            // thisUSB.Task()
+    Recovery,       // usbRecovery.Task()
+    Remote,
+    Knob,
+    Button,
+    Menu,
+    Commands,       // MiniDSP commands and requests, sent over USB
+    Count
+};
+
+constexpr const char * probeNames[] {
+    "pass", "state", "events", "triggers", "power", "requests", "display", "usb", "recovery", "remote", "knob",
+    "button", "menu", "commands"
+};
+static_assert(sizeof(probeNames) / sizeof(probeNames[0]) == (uint8_t)probe_t::Count, "A name for each probe");
+
+#ifdef NRF52_SERIES
+constexpr uint32_t probeCyclesPerUs = F_CPU / 1000000;
+inline uint32_t probeCycles() { return DWT->CYCCNT; }
+inline void probesBegin() { dwt_enable(); }
+#elif defined(UHS_HOST_MODEL)
+// On the host (tools/replay_host) micros() is simulated time, so time the host CPU instead: a cycle is a ns
+constexpr uint32_t probeCyclesPerUs = 1000;
+inline uint32_t probeCycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline void probesBegin() {}
+#else
+// No cycle counter: micros() scaled to nRF52840 cycles, so the buckets are the same
+constexpr uint32_t probeCyclesPerUs = 64;
+inline uint32_t probeCycles() { return micros() * probeCyclesPerUs; }
+inline void probesBegin() {}
+#endif
+
+// Count, min, mean and max of the times recorded, and a histogram for the percentiles: a bucket for
+// under 64 cycles (1 us), then one to each doubling (within 2x), the last holding everything from 16 ms.
+class CycleStats {
+
+    public:
+        static constexpr uint8_t buckets = 16;
+
+        void add(uint32_t cycles) {
+            _count++;
+            _total += cycles;
+            _min = min(_min, cycles);
+            _max = max(_max, cycles);
+            _histogram[bucket(cycles)]++;
+        }
+
+        // @brief Cycles that pct % of the times recorded were within: the top of their bucket, or the max if less
+        uint32_t percentile(uint8_t pct) const {
+            uint32_t wanted = ((uint64_t)_count * pct + 99) / 100;
+            uint32_t seen = 0;
+            for (uint8_t b = 0; b < buckets - 1; b++) {
+                seen += _histogram[b];
+                if (seen >= wanted) return min(top(b), _max);
+            }
+            return _max;
+        }
+
+        uint32_t count() const { return _count; }
+        uint32_t minimum() const { return _count ? _min : 0; }
+        uint32_t maximum() const { return _max; }
+        uint32_t mean() const { return _count ? _total / _count : 0; }
+
+        void reset() { *this = CycleStats(); }
+
+    private:
+        static uint8_t bucket(uint32_t cycles) {
+            uint8_t msb = 31 - __builtin_clz(cycles | 1);
+            if (msb < 6) return 0;
+            return min((uint8_t)(msb - 5), (uint8_t)(buckets - 1));
+        }
+
+        // The most cycles in bucket b
+        static uint32_t top(uint8_t b) {
+            return (2UL << (b + 5)) - 1;
+        }
+
+        uint32_t _count {0};
+        uint64_t _total {0};
+        uint32_t _min {UINT32_MAX};
+        uint32_t _max {0};
+        uint32_t _histogram[buckets] {};
+};
+
+// Adds the cycles from its construction to the end of its scope
+class ScopedProbe {
+
+    public:
+        ScopedProbe(CycleStats & stats) : _stats(stats), _start(probeCycles()) {}
+        ~ScopedProbe() { _stats.add(probeCycles() - _start); }
+
+    private:
+        CycleStats & _stats;
+        uint32_t _start;
+};
+
+// @brief Print a table of probes, times in us
+inline void printCycleStats(Print & out, const char * const names[], const CycleStats stats[], uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        const CycleStats & s = stats[i];
+        if (!s.count()) continue;
+        out.printf("%-22s %8lu", names[i], s.count());
+        for (uint32_t cycles : {s.minimum(), s.mean(), s.percentile(99), s.maximum()}) {
+            uint32_t tenths = (uint64_t)cycles * 10 / probeCyclesPerUs;
+            out.printf(" %7lu.%lu", tenths / 10, tenths % 10);
+        }
+        out.println();
+    }
+}
+
+#if TIMING_PROBES
+extern CycleStats loopProbes[(uint8_t)probe_t::Count];
+extern CycleStats handlerProbes[(uint8_t)ampEvent_t::Count];
+
+// @brief Print every probe that has run since the last reset: the loop's, then the handlers', by event
+inline void printProbes(Print & out) {
+    out.printf("%-22s %8s %9s %9s %9s %9s\n", "probe", "runs", "min us", "mean us", "p99 us", "max us");
+    printCycleStats(out, probeNames, loopProbes, (uint8_t)probe_t::Count);
+    printCycleStats(out, ampEventNames, handlerProbes, (uint8_t)ampEvent_t::Count);
+}
+
+inline void resetProbes() {
+    for (CycleStats & s : loopProbes) s.reset();
+    for (CycleStats & s : handlerProbes) s.reset();
+}
+
+#define PROBE(probe) ScopedProbe _probe(loopProbes[(uint8_t)probe_t::probe])
+#define PROBE_EVENT(type) ScopedProbe _probe(handlerProbes[(uint8_t)(type)])
+#else
+#define PROBE(probe)
+#define PROBE_EVENT(type)
+#endif
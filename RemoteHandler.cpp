@@ -28,6 +28,7 @@ bool Remote::getCommand() {
     decode();
     enableIRIn();                   // The library requires re-enable each time a code is received.
     if (!protocolNum) return false; // Unrecognizable code
+    onRemoteFrame(protocolNum, bits, value);
 
     //Serial.printf("getCommand got protocol %0X value %0X\r\n", protocolNum, value);
 
@@ -81,25 +82,28 @@ void Remote::stopListening() {
     getResults();
 }
 
-uint32_t Remote::getRawCommand(uint16_t wait) {
+void Remote::startRawCommand() {
 
     getResults();       // Ensure empty buffer
-    uint32_t startTime = millis();
     enableIRIn();
-    while (!getResults()) {
-        if (millis() - startTime > wait) return 0;
-    }
+}
+
+bool Remote::rawCommand(uint32_t & command) {
+
+    if (!getResults()) return false;
     decode();
     receivedTime = millis();
-    return value;
+    command = value;
+    return true;
 }
 
-bool Remote::learn(uint8_t item, uint16_t wait) {
+bool Remote::learn(uint8_t item) {
 
     if (item > tableLength) return false;
 
-    if (!getRawCommand(wait)) return false;
-    cmdTable[item].command = value;
+    uint32_t command;
+    if (!rawCommand(command) || !command) return false;
+    cmdTable[item].command = command;
     return true;
 }
 
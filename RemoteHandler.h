@@ -44,6 +44,9 @@ typedef void cmdHandler_t();    // Command handlers take nothing and return noth
 //extern cmdHandler_t volPlus, volMinus, mute, input, power;
 extern cmdHandler_t onRemoteVolMinus, onRemoteVolPlus, onRemoteMute, onRemoteSource, onRemotePower, onRemotePreset;
 
+// Called with each frame decoded, whether or not it's a command or a repeat (for the stimulus log)
+extern void onRemoteFrame(uint8_t protocol, uint8_t bits, uint32_t value);
+
 class Remote : public IRrecvPCI, IRdecode {
 
 // NEED TO TEST:
@@ -145,12 +148,17 @@ public:
     void stopListening();
 
     /**
-     * @brief Ensures that there is nothing in the input buffer, waits for a fresh command (button press), 
-     * and identifies the command received. Does not handle repeat codes. Used when learning a new remote.
-     * @param wait (ms) - how long to wait for the initial button press
-     * @return command code received, or 0 for timeout.  
+     * @brief Ensures that there is nothing in the input buffer and listens for a fresh command (button press),
+     * to be picked up with rawCommand(). Used when learning a new remote.
+     */
+    void startRawCommand();
+
+    /**
+     * @brief Identifies a command received since startRawCommand(), without waiting. Does not handle repeat codes.
+     * @param command (out) the command code received, or 0 if it couldn't be decoded
+     * @return A command was received
      */
-    uint32_t getRawCommand(uint16_t wait);
+    bool rawCommand(uint32_t & command);
 
     /**
      * @brief Checks for anything received, handles any special repeat codes, and re-enables the input.
@@ -164,12 +172,11 @@ public:
 
     /**
      * @brief Learns an IR code. 
-     * Waits to see a button press, then loads the first code seen into the dispatch table.
+     * Loads the first code seen since startRawCommand() into the dispatch table, without waiting.
      * @param item the item number in the dispatch table
-     * @param wait how long to wait (md)
      * @return command received.
      */
-    bool learn(uint8_t item, uint16_t wait);
+    bool learn(uint8_t item);
 
     /**
      * @brief Go to the next or previous item in the dispatch table.
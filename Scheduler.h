@@ -0,0 +1,146 @@
+// Cooperative scheduler for the main loop. Each task has a period, a deadline and a priority; every
+// pass of loop() runs the tasks that are due, highest priority (lowest number) first, each to completion.
+// A task with period 0 runs on every pass.
+// The scheduler keeps the CPU time of each task, and counts overruns: runs that started more than the
+// deadline after the task fell due. For a period 0 task that's a gap between runs longer than the deadline,
+// so it shows when something held up the loop.
+
+#pragma once
+
+#include <Arduino.h>
+
+// A task returns false if it couldn't do its work yet (e.g. waiting on the MiniDSP). It stays due,
+// and is tried again on the next pass.
+typedef bool (*taskFunction_t)();
+
+template <uint8_t maxTasks> class Scheduler {
+
+    public:
+        // @brief Add a task, run every period ms, due within deadline ms. Returns its id, or maxTasks if full.
+        uint8_t add(const char * name, taskFunction_t function, uint16_t period, uint16_t deadline, uint8_t priority) {
+            if (_count == maxTasks) return maxTasks;
+            uint8_t id = _count++;
+            _tasks[id] = {name, function, period * 1000UL, deadline * 1000UL, priority, micros(), {0, 0, 0, 0, 0}};
+            // Keep _order sorted by priority, first added first among equals
+            uint8_t i = id;
+            for (; i > 0 && _tasks[_order[i - 1]].priority > priority; i--) _order[i] = _order[i - 1];
+            _order[i] = id;
+            return id;
+        }
+
+        // @brief Hold off the task for a full period from now
+        void defer(uint8_t id) {
+            if (id < _count) _tasks[id].due = micros() + _tasks[id].period;
+        }
+
+        // @brief Make the task due now, so it runs in this pass (if not yet reached) or the next
+        void expedite(uint8_t id) {
+            if (id < _count) _tasks[id].due = micros();
+        }
+
+        // @brief One pass: run each task that's due
+        void run() {
+            uint32_t passStart = micros();
+            for (uint8_t i = 0; i < _count; i++) {
+                task_t & task = _tasks[_order[i]];
+                uint32_t start = micros();
+                uint32_t due = task.due;
+                if ((int32_t)(start - due) < 0) continue;
+                if (!task.function()) continue;
+                uint32_t end = micros();
+
+                uint32_t late = start - due;
+                task.stats.runs++;
+                task.stats.busy += end - start;
+                task.stats.maxRun = max(task.stats.maxRun, end - start);
+                task.stats.maxLate = max(task.stats.maxLate, late);
+                if (late > task.deadline) task.stats.overruns++;
+
+                // Next due a period on, unless the run deferred or expedited it. If a whole period was missed,
+                // start again from now rather than catch up.
+                if (task.due != due) continue;
+                task.due = task.period ? task.due + task.period : start;
+                if ((int32_t)(start - task.due) >= 0) task.due = start + task.period;
+            }
+            _passes++;
+            _maxPass = max(_maxPass, micros() - passStart);
+        }
+
+        // @brief Time (us) until the next task with a period falls due, or maxWait if none sooner
+        uint32_t untilDue(uint32_t maxWait) const {
+            uint32_t now = micros();
+            uint32_t wait = maxWait;
+            for (uint8_t i = 0; i < _count; i++) {
+                const task_t & task = _tasks[i];
+                if (!task.period) continue;
+                int32_t until = (int32_t)(task.due - now);
+                wait = min(wait, (uint32_t)max(until, (int32_t)0));
+            }
+            return wait;
+        }
+
+        // @brief Account for the loop having slept since start (micros()). Tasks run every pass aren't late for it.
+        void slept(uint32_t start) {
+            uint32_t now = micros();
+            _asleep += now - start;
+            for (uint8_t i = 0; i < _count; i++) {
+                if (!_tasks[i].period) _tasks[i].due = now;
+            }
+        }
+
+        // @brief Print, for each task, runs, share of the CPU, mean and longest run, overruns and the
+        // latest start since the last reset; then the time asleep, and what's left (scheduler overhead and idle polling).
+        void print(Print & out) const {
+            uint32_t elapsed = micros() - _statsStart;
+            uint32_t busy = 0;
+            out.printf("%lu passes in %lu ms, longest %lu us\n", _passes, elapsed / 1000, _maxPass);
+            out.printf("%-10s %8s %6s %8s %8s %8s %9s\n", "task", "runs", "cpu %", "mean us", "max us", "overruns", "late ms");
+            for (uint8_t i = 0; i < _count; i++) {
+                const task_t & task = _tasks[_order[i]];
+                busy += task.stats.busy;
+                uint32_t share = permille(task.stats.busy, elapsed);
+                out.printf("%-10s %8lu %4lu.%lu %8lu %8lu %8lu %7lu.%lu\n", task.name, task.stats.runs,
+                    share / 10, share % 10, task.stats.runs ? task.stats.busy / task.stats.runs : 0,
+                    task.stats.maxRun, task.stats.overruns, task.stats.maxLate / 1000, task.stats.maxLate / 100 % 10);
+            }
+            uint32_t asleep = permille(_asleep, elapsed), other = permille(elapsed - busy - _asleep, elapsed);
+            out.printf("%-10s %8s %4lu.%lu\n", "asleep", "", asleep / 10, asleep % 10);
+            out.printf("%-10s %8s %4lu.%lu\n", "other", "", other / 10, other % 10);
+        }
+
+        void resetStats() {
+            for (uint8_t i = 0; i < _count; i++) _tasks[i].stats = {0, 0, 0, 0, 0};
+            _passes = _maxPass = _asleep = 0;
+            _statsStart = micros();
+        }
+
+    private:
+        struct taskStats_t {
+            uint32_t runs;
+            uint32_t busy;          // us
+            uint32_t maxRun;        // us
+            uint32_t maxLate;       // us
+            uint32_t overruns;
+        };
+
+        struct task_t {
+            const char * name;
+            taskFunction_t function;
+            uint32_t period;        // us
+            uint32_t deadline;      // us
+            uint8_t priority;
+            uint32_t due;           // micros()
+            taskStats_t stats;
+        };
+
+        // @brief part/whole in tenths of a percent, so the tables print without printf float support
+        static uint32_t permille(uint32_t part, uint32_t whole) { return whole ? (uint64_t)1000 * part / whole : 0; }
+
+        task_t _tasks[maxTasks];
+        uint8_t _order[maxTasks];   // Task ids by priority
+        uint8_t _count {0};
+        uint32_t _passes {0};
+        uint32_t _maxPass {0};
+        uint32_t _asleep {0};       // us
+        uint32_t _statsStart {0};
+};
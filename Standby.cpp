@@ -0,0 +1,59 @@
+// Standby for the Off state
+
+#include <Arduino.h>
+#include "Standby.h"
+#include "src/IR/IRLibRecvPCI.h"
+
+// The IR receiver's interrupt handler calls this at the start of each frame
+void IRrecvPCI_FrameStart() { Standby::instance().wake(Standby::Remote); }
+
+void Standby::begin(uint8_t buttonPin) {
+    _buttonPin = buttonPin;
+    _wakeup = xSemaphoreCreateBinary();
+    _statsStart = millis();
+}
+
+void Standby::enter() {
+    if (_active) return;
+    attachInterrupt(digitalPinToInterrupt(_buttonPin), buttonWake, FALLING);
+    _active = true;
+}
+
+void Standby::exit() {
+    if (!_active) return;
+    detachInterrupt(digitalPinToInterrupt(_buttonPin));
+    _active = false;
+}
+
+void Standby::buttonWake() { instance().wake(Button); }
+
+void Standby::sleep(uint32_t ms) {
+    uint32_t start = millis();
+    _wakeSource = Timer;
+    _sleeping = true;                               // A wake from here on ends the take at once
+    xSemaphoreTake(_wakeup, ms2tick(ms));
+    _sleeping = false;
+    _wakes[_wakeSource]++;
+    _asleep += millis() - start;
+}
+
+void Standby::wake(wake_t source) {
+    if (!_sleeping) return;
+    _wakeSource = source;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(_wakeup, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void Standby::printStats(Print & out) {
+    uint32_t elapsed = millis() - _statsStart;
+    uint32_t share = elapsed ? (uint64_t)1000 * _asleep / elapsed : 0;
+    out.printf("Asleep %lu of %lu ms (%lu.%lu%%), woken by timer %lu, button %lu, remote %lu\n", _asleep, elapsed,
+        share / 10, share % 10, _wakes[Timer], _wakes[Button], _wakes[Remote]);
+}
+
+void Standby::resetStats() {
+    _asleep = 0;
+    for (uint32_t & wakes : _wakes) wakes = 0;
+    _statsStart = millis();
+}
@@ -0,0 +1,72 @@
+// Standby for the Off and warm standby states. Between trigger samples the loop sleeps, blocked on a
+// semaphore, and FreeRTOS's tickless idle stops the tick and waits for an event (System ON sleep) until
+// an interrupt or the timeout. A press of the encoder button or the first mark of an IR frame wakes it at once.
+
+#pragma once
+
+#include <Arduino.h>
+
+class Standby {
+
+    public:
+        enum wake_t : uint8_t {
+            Timer,
+            Button,
+            Remote,
+            wakeCount
+        };
+
+        static Standby & instance() {
+            static Standby _instance;
+            return _instance;
+        }
+
+        /**
+         * @brief Setup
+         * @param buttonPin The encoder button, closed low
+         */
+        void begin(uint8_t buttonPin);
+
+        /**
+         * @brief Start standby: the button wakes the loop from sleep()
+         */
+        void enter();
+
+        /**
+         * @brief End standby
+         */
+        void exit();
+
+        bool active() const { return _active; }
+
+        /**
+         * @brief Sleep until woken by the button or the remote, or for ms
+         */
+        void sleep(uint32_t ms);
+
+        /**
+         * @brief Wake the loop from sleep(). Callable from an interrupt handler.
+         */
+        void wake(wake_t source);
+
+        /**
+         * @brief Print the time asleep and the wakes by source since the last reset
+         */
+        void printStats(Print & out);
+        void resetStats();
+
+    private:
+        Standby() {}
+
+        static void buttonWake();
+
+        SemaphoreHandle_t _wakeup {nullptr};
+        uint8_t _buttonPin {0};
+        bool _active {false};
+        volatile bool _sleeping {false};
+        volatile wake_t _wakeSource {Timer};
+
+        uint32_t _asleep {0};               // ms
+        uint32_t _statsStart {0};           // millis()
+        uint32_t _wakes[wakeCount] {0, 0, 0};
+};
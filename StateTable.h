@@ -0,0 +1,210 @@
+// The states of the amp state machine, the triggers that move it between them, and the transitions
+// as a table that the compiler checks. The states themselves (entry, exit, polls and event handlers)
+// are in AmpController.ino; a handler that wants to leave its state fires a trigger, and the table
+// says where that leads.
+// Also a trace of the last transitions taken, for looking back at how the amp got where it is.
+
+#pragma once
+
+#include <Arduino.h>
+
+enum class ampStateId_t : uint8_t {
+    Off,
+    Menu,
+    WaitDSP,
+    CyclePower,
+    WaitSource,
+    SetGain,
+    WaitVolume,
+    WaitMute,
+    On,
+    ChoosePreset,
+    SetPreset,
+    WarmStandby,
+    Count
+};
+
+enum class ampTrigger_t : uint8_t {
+    Start,              // setup()
+    RemotePower,
+    ButtonShortPress,
+    ButtonFullHold,
+    TriggerRise,
+    MenuExit,
+    DSPConnected,
+    DSPTimeout,         // usbRecovery has nothing left but a power cycle
+    DSPLost,            // a MiniDSP has dropped off the bus
+    PowerCycled,        // the power has been off for DSPPowerDownTime
+    SourceSet,          // source verified to match the triggers (or the choice)
+    GainSet,            // input gains verified to match the options
+    VolumeSet,          // volume verified to be within limits
+    Unmuted,            // mute verified to be off
+    InputGone,          // silence without trigger, or trigger loss when the other is low
+    SourceChange,       // trigger loss when the other is high, or a source change from the remote or button
+    RemotePreset,
+    PresetTimeout,      // no preset press for CHOOSE_PRESET_TIMEOUT
+    PresetSet,          // the MiniDSP reports the new preset, or there was none to set
+    TestCycle,          // VBUS_DEBUG power cycle test
+    Resume,             // trigger rise for the current source, button or remote, in warm standby
+    WarmTimeout,        // warm standby time passed, or the MiniDSP has gone
+    Count
+};
+
+// Names, for the trace
+constexpr const char * ampStateNames[] {
+    "Off", "Menu", "WaitDSP", "CyclePower", "WaitSource", "SetGain", "WaitVolume", "WaitMute",
+    "On", "ChoosePreset", "SetPreset", "WarmStandby"
+};
+constexpr const char * ampTriggerNames[] {
+    "Start", "RemotePower", "ButtonShortPress", "ButtonFullHold", "TriggerRise", "MenuExit",
+    "DSPConnected", "DSPTimeout", "DSPLost", "PowerCycled", "SourceSet", "GainSet", "VolumeSet", "Unmuted",
+    "InputGone", "SourceChange", "RemotePreset", "PresetTimeout", "PresetSet", "TestCycle",
+    "Resume", "WarmTimeout"
+};
+static_assert(sizeof(ampStateNames) / sizeof(ampStateNames[0]) == (uint8_t)ampStateId_t::Count, "A name for each state");
+static_assert(sizeof(ampTriggerNames) / sizeof(ampTriggerNames[0]) == (uint8_t)ampTrigger_t::Count, "A name for each trigger");
+
+// Guards, defined with the states
+bool presetChanged();
+bool warmStandbyEnabled();
+
+// A trigger in state from leads to state to, if the guard (when there is one) returns true.
+// Rows for the same state and trigger are tried in order, so guarded rows come first and the last is unguarded.
+struct transition_t {
+    ampStateId_t from;
+    ampTrigger_t trigger;
+    bool (*guard)();
+    ampStateId_t to;
+};
+
+constexpr transition_t ampTransitions[] {
+    // From                         Trigger                         Guard           To
+    {ampStateId_t::Off,             ampTrigger_t::Start,            nullptr,        ampStateId_t::Off},
+    {ampStateId_t::Off,             ampTrigger_t::RemotePower,      nullptr,        ampStateId_t::WaitDSP},
+    {ampStateId_t::Off,             ampTrigger_t::ButtonShortPress, nullptr,        ampStateId_t::WaitDSP},
+    {ampStateId_t::Off,             ampTrigger_t::TriggerRise,      nullptr,        ampStateId_t::WaitDSP},
+    {ampStateId_t::Off,             ampTrigger_t::ButtonFullHold,   nullptr,        ampStateId_t::Menu},
+    {ampStateId_t::Menu,            ampTrigger_t::MenuExit,         nullptr,        ampStateId_t::Off},
+    {ampStateId_t::WaitDSP,         ampTrigger_t::DSPConnected,     nullptr,        ampStateId_t::WaitSource},
+    {ampStateId_t::WaitDSP,         ampTrigger_t::DSPTimeout,       nullptr,        ampStateId_t::CyclePower},
+    {ampStateId_t::CyclePower,      ampTrigger_t::PowerCycled,      nullptr,        ampStateId_t::WaitDSP},
+    {ampStateId_t::WaitSource,      ampTrigger_t::SourceSet,        nullptr,        ampStateId_t::SetGain},
+    {ampStateId_t::SetGain,         ampTrigger_t::GainSet,          nullptr,        ampStateId_t::WaitVolume},
+    {ampStateId_t::WaitVolume,      ampTrigger_t::VolumeSet,        nullptr,        ampStateId_t::WaitMute},
+    {ampStateId_t::WaitMute,        ampTrigger_t::Unmuted,          nullptr,        ampStateId_t::On},
+    {ampStateId_t::On,              ampTrigger_t::RemotePower,      nullptr,        ampStateId_t::Off},
+    {ampStateId_t::On,              ampTrigger_t::ButtonFullHold,   nullptr,        ampStateId_t::Off},
+    {ampStateId_t::On,              ampTrigger_t::InputGone,        warmStandbyEnabled, ampStateId_t::WarmStandby},
+    {ampStateId_t::On,              ampTrigger_t::InputGone,        nullptr,        ampStateId_t::Off},
+    {ampStateId_t::On,              ampTrigger_t::SourceChange,     nullptr,        ampStateId_t::WaitSource},
+    {ampStateId_t::On,              ampTrigger_t::RemotePreset,     nullptr,        ampStateId_t::ChoosePreset},
+    {ampStateId_t::On,              ampTrigger_t::TestCycle,        nullptr,        ampStateId_t::Off},
+    {ampStateId_t::On,              ampTrigger_t::DSPLost,          nullptr,        ampStateId_t::WaitDSP},
+    {ampStateId_t::ChoosePreset,    ampTrigger_t::PresetTimeout,    presetChanged,  ampStateId_t::SetPreset},
+    {ampStateId_t::ChoosePreset,    ampTrigger_t::PresetTimeout,    nullptr,        ampStateId_t::On},
+    {ampStateId_t::SetPreset,       ampTrigger_t::PresetSet,        nullptr,        ampStateId_t::On},
+    {ampStateId_t::WarmStandby,     ampTrigger_t::Resume,           nullptr,        ampStateId_t::WaitMute},
+    {ampStateId_t::WarmStandby,     ampTrigger_t::SourceChange,     nullptr,        ampStateId_t::WaitSource},
+    {ampStateId_t::WarmStandby,     ampTrigger_t::ButtonFullHold,   nullptr,        ampStateId_t::Off},
+    {ampStateId_t::WarmStandby,     ampTrigger_t::WarmTimeout,      nullptr,        ampStateId_t::Off},
+};
+
+constexpr uint8_t ampTransitionCount = sizeof(ampTransitions) / sizeof(ampTransitions[0]);
+
+// Compile-time checks of the table
+
+constexpr bool sameCell(const transition_t & a, const transition_t & b) {
+    return a.from == b.from && a.trigger == b.trigger;
+}
+
+// @brief Whether there's a row, at or after row i, for the trigger in state from
+constexpr bool hasTransition(ampStateId_t from, ampTrigger_t trigger, uint8_t i = 0) {
+    return i < ampTransitionCount
+        && ((ampTransitions[i].from == from && ampTransitions[i].trigger == trigger) || hasTransition(from, trigger, i + 1));
+}
+
+// @brief Whether a row at or after j is for the same cell as row i, and (if unguarded) is unguarded
+constexpr bool laterRow(uint8_t i, uint8_t j, bool unguarded) {
+    return j < ampTransitionCount
+        && ((sameCell(ampTransitions[i], ampTransitions[j]) && (!unguarded || ampTransitions[j].guard == nullptr))
+            || laterRow(i, j + 1, unguarded));
+}
+
+// @brief A guarded row needs an unguarded one after it, for when the guard fails. An unguarded row
+// must be the last for its cell, since no row after it could be taken.
+constexpr bool rowValid(uint8_t i) {
+    return ampTransitions[i].from < ampStateId_t::Count && ampTransitions[i].to < ampStateId_t::Count
+        && ampTransitions[i].trigger < ampTrigger_t::Count
+        && (ampTransitions[i].guard != nullptr ? laterRow(i, i + 1, true) : !laterRow(i, i + 1, false));
+}
+
+constexpr bool tableValid(uint8_t i = 0) {
+    return i == ampTransitionCount || (rowValid(i) && tableValid(i + 1));
+}
+
+// @brief Whether some row, at or after row i, enters (to) or leaves (!to) the state
+constexpr bool stateInTable(ampStateId_t state, bool to, uint8_t i = 0) {
+    return i < ampTransitionCount
+        && ((to ? ampTransitions[i].to : ampTransitions[i].from) == state || stateInTable(state, to, i + 1));
+}
+
+// @brief Whether every state, from s on, can be both entered and left
+constexpr bool statesConnected(uint8_t s = 0) {
+    return s == (uint8_t)ampStateId_t::Count
+        || (stateInTable((ampStateId_t)s, true) && stateInTable((ampStateId_t)s, false) && statesConnected(s + 1));
+}
+
+static_assert(tableValid(), "Each guarded transition needs an unguarded one after it, and nothing may follow an unguarded one");
+static_assert(statesConnected(), "Every state must be entered and left by some transition");
+
+// Take the transition for the trigger in state from. Defined with the states.
+void takeTransition(ampStateId_t from, ampTrigger_t trigger);
+
+// @brief Fire a trigger from a state's handler. The state and trigger are template parameters so that
+// a trigger with no row in the table for the state is a compile error rather than a lost transition.
+template <ampStateId_t from, ampTrigger_t trigger> inline void fire() {
+    static_assert(hasTransition(from, trigger), "No transition in the table for this state and trigger");
+    takeTransition(from, trigger);
+}
+
+struct transitionRecord_t {
+    uint32_t time;              // millis() when taken
+    ampStateId_t from;
+    ampTrigger_t trigger;
+    ampStateId_t to;
+};
+
+// The last size transitions taken, oldest overwritten first
+template <uint8_t size> class TransitionTrace {
+
+    public:
+        void record(uint32_t time, ampStateId_t from, ampTrigger_t trigger, ampStateId_t to) {
+            _records[_next] = {time, from, trigger, to};
+            _next = (_next + 1) % size;
+            if (_count < size) _count++;
+            _total++;
+        }
+
+        // @brief Print the transitions held, oldest first, with the time of each
+        void print(Print & out) const {
+            out.printf("Last %u of %lu transitions\n", _count, _total);
+            for (uint8_t i = 0; i < _count; i++) {
+                const transitionRecord_t & r = _records[(_next + size - _count + i) % size];
+                out.printf("%10lu %-12s --%s--> %s\n", r.time, ampStateNames[(uint8_t)r.from],
+                    ampTriggerNames[(uint8_t)r.trigger], ampStateNames[(uint8_t)r.to]);
+            }
+        }
+
+        void clear() { _next = _count = 0; }
+
+        // @brief Transitions taken since boot, and one of those held: back 0 is the latest, up to count() - 1
+        uint32_t total() const { return _total; }
+        uint8_t count() const { return _count; }
+        const transitionRecord_t & recent(uint8_t back) const { return _records[(_next + size - 1 - back) % size]; }
+
+    private:
+        transitionRecord_t _records[size];
+        uint8_t _next {0};
+        uint8_t _count {0};
+        uint32_t _total {0};
+};
@@ -0,0 +1,172 @@
+// Stimulus log: the inputs the controller acted on (IR frames, knob turns, button edges, trigger samples
+// and the MiniDSP's input levels), each with its time, in a ring of compact binary records. Dumped on
+// Serial ('l'), it replays on the host through the same state machine (tools/replay_host), to check a
+// change against a recorded session, or to profile the handlers on hours of use in seconds.
+// A record is the stimulus type, the ms since the previous record (7 bits to a byte, low first: one byte
+// up to 127 ms), then the payload. When the ring is full the oldest records go.
+// STIMULUS_LOG (Configuration.h) is the ring's size in bytes; 0 removes the log and the console command.
+// The ring isn't locked: record only from loop(). With RTOS_TASKS the levels are logged as they're dispatched.
+
+#pragma once
+
+#include <Arduino.h>
+#include "Options.h"
+
+enum class stimulus_t : uint8_t {
+    Remote,         // a decoded IR frame: protocol, bits, value (4 bytes, low first)
+    Knob,           // the change passed to onKnobTurned()
+    Button,         // the button's raw level: 1 closed
+    Triggers,       // raw ADC samples, analog then digital (2 bytes each, low first)
+    Levels,         // MiniDSP input levels, left and right, in -0.5 dB steps
+    Count
+};
+
+constexpr const char * stimulusNames[] {"remote", "knob", "button", "triggers", "levels"};
+static_assert(sizeof(stimulusNames) / sizeof(stimulusNames[0]) == (uint8_t)stimulus_t::Count, "A name for each stimulus");
+
+constexpr uint8_t stimulusSizes[] {6, 1, 1, 4, 2};
+static_assert(sizeof(stimulusSizes) / sizeof(stimulusSizes[0]) == (uint8_t)stimulus_t::Count, "A size for each stimulus");
+
+// @brief An input level in dB as a log payload byte: -0.5 dB steps from 0 dB, down to -127.5 dB
+inline uint8_t stimulusLevel(float dB) { return dB >= 0 ? 0 : dB <= -127.5f ? 255 : (uint8_t)(-dB * 2 + 0.5f); }
+
+// Writes the bytes it's given as hex, 32 to a line
+class HexPrint : public Print {
+
+    public:
+        HexPrint(Print & out) : _out(out) {}
+
+        size_t write(uint8_t c) override {
+            _out.printf("%02X", c);
+            if (++_column == 32) end();
+            return 1;
+        }
+        using Print::write;
+
+        // @brief Finish a part-filled line
+        void end() {
+            if (_column) _out.println();
+            _column = 0;
+        }
+
+    private:
+        Print & _out;
+        uint8_t _column {0};
+};
+
+template <uint16_t size> class StimulusLog {
+
+    public:
+        // @brief Add a record, at millis() now
+        void record(stimulus_t type, const uint8_t * payload) {
+            uint32_t now = millis();
+            uint8_t bytes[1 + 5 + 6];
+            uint8_t length = 0;
+            bytes[length++] = (uint8_t)type;
+            for (uint32_t delta = now - _lastTime; ; delta >>= 7) {
+                bytes[length++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+                if (delta <= 0x7F) break;
+            }
+            memcpy(bytes + length, payload, stimulusSizes[(uint8_t)type]);
+            length += stimulusSizes[(uint8_t)type];
+
+            while (_used + length > size) drop();
+            for (uint8_t i = 0; i < length; i++) _ring[(_head + _used + i) % size] = bytes[i];
+            _used += length;
+            _lastTime = now;
+            _records++;
+        }
+
+        void remote(uint8_t protocol, uint8_t bits, uint32_t value) {
+            uint8_t payload[] {protocol, bits, (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+            record(stimulus_t::Remote, payload);
+        }
+
+        void knob(int8_t change) { record(stimulus_t::Knob, (const uint8_t *)&change); }
+
+        // @brief The button's raw level, if it has changed since the last record of it
+        void button(bool closed) {
+            if (closed == _closed) return;
+            _closed = closed;
+            uint8_t payload {closed};
+            record(stimulus_t::Button, &payload);
+        }
+
+        // @brief A trigger sample pair, if either has moved more than deadband since the last record of them
+        void triggers(uint16_t analog, uint16_t digital, uint16_t deadband) {
+            if (abs(analog - _analog) <= deadband && abs(digital - _digital) <= deadband) return;
+            _analog = analog;
+            _digital = digital;
+            uint8_t payload[] {(uint8_t)analog, (uint8_t)(analog >> 8), (uint8_t)digital, (uint8_t)(digital >> 8)};
+            record(stimulus_t::Triggers, payload);
+        }
+
+        // @brief Input levels (dB), if either has changed by a step since the last record of them
+        void levels(float left, float right) {
+            uint8_t payload[] {stimulusLevel(left), stimulusLevel(right)};
+            if (payload[0] == _levels[0] && payload[1] == _levels[1]) return;
+            memcpy(_levels, payload, sizeof(_levels));
+            record(stimulus_t::Levels, payload);
+        }
+
+        /**
+         * @brief Write the log: a header ("SLG1", the time the first record counts from, the records'
+         * length, the options' length, and 1 if records have been dropped), the records, then the options
+         * in force, so that the replay runs with the same settings
+         */
+        void write(Print & out, const Options & options) const {
+            uint16_t optionsSize = options.size();
+            uint8_t header[] {'S', 'L', 'G', '1',
+                (uint8_t)_baseTime, (uint8_t)(_baseTime >> 8), (uint8_t)(_baseTime >> 16), (uint8_t)(_baseTime >> 24),
+                (uint8_t)_used, (uint8_t)(_used >> 8), (uint8_t)optionsSize, (uint8_t)(optionsSize >> 8), _dropped > 0};
+            out.write(header, sizeof(header));
+            for (uint16_t i = 0; i < _used; i++) out.write(_ring[(_head + i) % size]);
+            options.write(out);
+        }
+
+        // @brief Write the log as hex lines between "SLG1 BEGIN" and "SLG1 END", for a serial capture
+        void dump(Print & out, const Options & options) const {
+            HexPrint hex(out);
+            out.println("SLG1 BEGIN");
+            write(hex, options);
+            hex.end();
+            out.println("SLG1 END");
+        }
+
+        // @brief Records added and dropped since boot, and bytes held
+        uint32_t records() const { return _records; }
+        uint32_t dropped() const { return _dropped; }
+        uint16_t used() const { return _used; }
+
+    private:
+        // Drop the oldest record, moving the time the first counts from on to its time
+        void drop() {
+            stimulus_t type = (stimulus_t)_ring[_head];
+            uint16_t i = 1;
+            uint32_t delta = 0;
+            for (uint8_t shift = 0; ; shift += 7) {
+                uint8_t b = _ring[(_head + i++) % size];
+                delta |= (uint32_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) break;
+            }
+            i += stimulusSizes[(uint8_t)type];
+            _baseTime += delta;
+            _head = (_head + i) % size;
+            _used -= i;
+            _dropped++;
+        }
+
+        uint8_t _ring[size];
+        uint16_t _head {0};             // The oldest record
+        uint16_t _used {0};             // Bytes
+        uint32_t _baseTime {0};         // millis() the oldest record's delta counts from
+        uint32_t _lastTime {0};         // millis() of the newest record
+        uint32_t _records {0};
+        uint32_t _dropped {0};
+
+        // The last recorded, for the stimuli recorded on change
+        bool _closed {false};
+        uint16_t _analog {0};
+        uint16_t _digital {0};
+        uint8_t _levels[2] {0, 0};
+};
@@ -22,6 +22,8 @@
 
 void IRrecvPCI_Handler();//prototype for interrupt handler
 
+__attribute__((weak)) void IRrecvPCI_FrameStart(void) {}
+
 /* Note that the constructor is passed the interrupt number rather than the pin number.
  * WARNING: These interrupt numbers which are passed to �attachInterrupt()� are not
  * necessarily identical to the interrupt numbers in the datasheet of the processor chip 
@@ -96,6 +98,10 @@ bool IRrecvPCI::getResults(void) {
   return false;
 };
 
+bool IRrecvPCI::receiving(void) {
+  return recvGlobal.newDataAvailable || recvGlobal.currentState==STATE_RUNNING;
+}
+
 /* This is the interrupt handler used by this class. It is called every time the input
  * pin changes from high to low or from low to high. The initial state of the state machine
  * is STATE_READY_TO_BEGIN. It waits until it sees a MARK before it switches to
@@ -124,6 +130,7 @@ void IRrecvPCI_Handler(){
         return;//don't start until we get a MARK
       } else {
         recvGlobal.currentState=STATE_RUNNING;
+        IRrecvPCI_FrameStart();
       }
       break;
   };
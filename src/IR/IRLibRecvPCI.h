@@ -29,7 +29,13 @@ public:
   void enableIRIn(void); //call to initialize or resume receiving
   bool getResults(void); //returns true if new frame of data has been received
   void disableIRIn(void); //ISR runs continuously once started. Use this if you want to stop.
+  bool receiving(void); //true while a frame is coming in or waiting to be read
 private:
   uint8_t intrNum;
 };
+
+/* Called from the interrupt handler at the first mark of each frame. The default does nothing;
+ * define it in the sketch to be told (e.g. to wake from sleep) as soon as a frame starts.
+ */
+void IRrecvPCI_FrameStart(void);
 #endif //IRLibRecvPCI_h
@@ -242,7 +242,7 @@ void MiniDSP::parseDSPWriteResponse(const uint8_t * buf) {
         if (pFuncOnNewInputGains != nullptr && newInputGains) pFuncOnNewInputGains(inputGains);
 }
 
-void MiniDSP::ParseHIDData(USBHID *hid __attribute__ ((unused)), bool is_rpt_id __attribute__ ((unused)), uint8_t len, uint8_t *buf) {
+void MiniDSP::ParseHIDData(USBHID *hid __attribute__ ((unused)), bool is_rpt_id __attribute__ ((unused)), uint8_t len __attribute__ ((unused)), uint8_t *buf) {
 
         // Serial.printf("parsing ");
         // for (int i=0; i < 12; i++) Serial.printf("%X ", buf[i]);
@@ -304,6 +304,14 @@ uint8_t MiniDSP::OnInitSuccessful() {
         return 0;
 };
 
+uint8_t MiniDSP::Release() {
+        bool wasConnected = connected();
+        uint8_t rcode = HIDUniversal::Release();
+        if(wasConnected && pFuncOnRelease != nullptr)
+                pFuncOnRelease();
+        return rcode;
+}
+
 uint8_t MiniDSP::Checksum(const uint8_t *data, uint8_t data_length) const {
         uint16_t sum = 0;
         for(uint8_t i = 0; i < data_length; i++)
@@ -337,7 +345,9 @@ void MiniDSP::SendCommand(const uint8_t *command, uint8_t command_length) const
         // Pad the rest.
         memset(&buf[checksumOffset + 1], 0xFF, sizeof (buf) - checksumOffset - 1);
 
-        pUsb->outTransfer(bAddress, epInfo[epInterruptOutIndex].epAddr, sizeof (buf), buf);
+        // Every command is answered on the interrupt IN endpoint, so poll for it promptly
+        if(pUsb->outTransfer(bAddress, epInfo[epInterruptOutIndex].epAddr, sizeof (buf), buf) == 0)
+                ExpectResponse();
 }
 
 void MiniDSP::RequestStatus() const {
@@ -465,4 +475,55 @@ void MiniDSP::setInputGain(const float gain) {
         putFloatLE(&buf[8], gain);
         SendCommand(buf, 12);
 
-}
\ No newline at end of file
+}
+
+bool MiniDSPGroup::add(MiniDSP *unit) {
+        if(nUnits >= maxUnits)
+                return false;
+        units[nUnits++] = unit;
+        return true;
+}
+
+bool MiniDSPGroup::connected() const {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(!units[i]->connected())
+                        return false;
+        return true;
+}
+
+bool MiniDSPGroup::acknowledged() const {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected() && units[i]->ResponsePending())
+                        return false;
+        return true;
+}
+
+void MiniDSPGroup::setVolume(uint8_t volume) {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected())
+                        units[i]->setVolume(volume);
+}
+
+void MiniDSPGroup::setMute(bool muteOn) {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected())
+                        units[i]->setMute(muteOn);
+}
+
+void MiniDSPGroup::setSource(source_t source) {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected())
+                        units[i]->setSource(source);
+}
+
+void MiniDSPGroup::setPreset(uint8_t preset, bool reset) {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected())
+                        units[i]->setPreset(preset, reset);
+}
+
+void MiniDSPGroup::setInputGain(const float gain) {
+        for(uint8_t i = 0; i < nUnits; i++)
+                if(units[i]->connected())
+                        units[i]->setInputGain(gain);
+}
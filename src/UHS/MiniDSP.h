@@ -74,6 +74,15 @@ public:
                 pFuncOnInit = funcOnInit;
         };
 
+        /**
+         * Used to call your own function when a connected device is released,
+         * e.g. because it has dropped off the bus.
+         * @param funcOnRelease Function to call.
+         */
+        void attachOnRelease(void (*funcOnRelease)(void)) {
+                pFuncOnRelease = funcOnRelease;
+        };
+
         /**
          * Used to call your own function when receiving source data
          * The source is passed as an unsigned 8-bit integer with 0 = Analog, 1 = Toslink, 2 = USB (shouldn't occur).
@@ -318,6 +327,12 @@ protected:
         uint8_t OnInitSuccessful();
         /**@}*/
 
+        /**
+         * Called by the USB core when the device goes. Use
+         * attachOnRelease(void (*funcOnRelease)(void)) to call your own function.
+         */
+        uint8_t Release() override;
+
         /** @name USBDeviceConfig implementation */
 
         /**
@@ -405,6 +420,9 @@ private:
         // Pointer to function called in onInit().
         void (*pFuncOnInit)(void) = nullptr;
 
+        // Pointer to function called when a connected device is released.
+        void (*pFuncOnRelease)(void) = nullptr;
+
         // Pointer to function called on change in the source
         void (*pFuncOnSourceChange)(source_t) = nullptr;
 
@@ -452,3 +470,58 @@ private:
 
         float inputGains[2] = { -128.0, -128.0 };
 };
+
+/**
+ * Several MiniDSPs (e.g. mains and subs behind a hub) driven as one.
+ *
+ * Set commands go to every connected unit back to back. Sending is
+ * non-blocking past the OUT transfer, so the units' round trips overlap and a
+ * change costs about one round trip however many units there are.
+ * acknowledged() gathers the responses: it stays false until every unit has
+ * answered its last command (or HIDUniversal's response timeout has expired).
+ *
+ * The first unit is the primary. Attach the application's callbacks to it;
+ * its state is what the application reads back.
+ */
+class MiniDSPGroup {
+public:
+        static const uint8_t maxUnits = 4;
+
+        MiniDSPGroup(MiniDSP *primary) {
+                add(primary);
+        };
+
+        /**
+         * Add a unit to the group.
+         * @return false if the group is full.
+         */
+        bool add(MiniDSP *unit);
+
+        uint8_t count() const {
+                return nUnits;
+        };
+
+        MiniDSP& primary() const {
+                return *units[0];
+        };
+
+        /**
+         * @return true when every unit in the group is connected.
+         */
+        bool connected() const;
+
+        /**
+         * @return true when no connected unit has a response outstanding.
+         */
+        bool acknowledged() const;
+
+        void setVolume(uint8_t volume);
+        void setMute(bool muteOn);
+        void setSource(source_t source);
+        void setPreset(uint8_t preset, bool reset = true);
+        void setInputGain(const float gain);
+
+private:
+        MiniDSP *units[maxUnits] = {};
+        uint8_t nUnits = 0;
+};
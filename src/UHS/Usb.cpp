@@ -139,6 +139,8 @@ uint8_t USB::ctrlReq(uint8_t addr, uint8_t ep, uint8_t bmReqType, uint8_t bReque
         USBTRACE3("     - wInd ", wInd, 0x81);
         USBTRACE3("     - total ", total, 0x81);
         USBTRACE3("     - nbytes ", nbytes, 0x81);
+        USBEVENT(UHS_EV_CTRL_REQ, (addr << 4) | (ep & 0x0f), (bmReqType << 8) | bRequest);
+        USBEVENT(UHS_EV_CTRL_VALUE, wValHi, total);
         
         EpInfo *pep = NULL;
         uint16_t nak_limit = 0;
@@ -227,6 +229,7 @@ uint8_t USB::inTransfer(uint8_t addr, uint8_t ep, uint16_t *nbytesptr, uint8_t*
                 USBTRACE3("(USB::InTransfer) SetAddress Failed ", rcode, 0x81);
                 USBTRACE3("(USB::InTransfer) addr requested ", addr, 0x81);
                 USBTRACE3("(USB::InTransfer) ep requested ", ep, 0x81);
+                USBEVENT(UHS_EV_SETADDR_FAIL, rcode, (addr << 8) | ep);
                 return rcode;
         }
         return InTransfer(pep, nak_limit, nbytesptr, data, bInterval);
@@ -242,6 +245,7 @@ uint8_t USB::InTransfer(EpInfo *pep, uint16_t nak_limit, uint16_t *nbytesptr, ui
 
         USBTRACE1("   => InTransfer\r\n", 0x90);
         USBTRACE3("      - Requesting ", nbytes, 0x90);
+        USBEVENT(UHS_EV_IN_XFER, pep->epAddr, nbytes);
 
         *nbytesptr = 0;
         regWr(rHCTL, (pep->bmRcvToggle) ? bmRCVTOG1 : bmRCVTOG0); //set toggle value
@@ -311,6 +315,7 @@ uint8_t USB::InTransfer(EpInfo *pep, uint16_t nak_limit, uint16_t *nbytesptr, ui
         } //while( 1 )
         
         USBTRACE3("      - Total ", *nbytesptr, 0x90);
+        USBEVENT(UHS_EV_IN_DONE, rcode, *nbytesptr);
 
         return ( rcode);
 }
@@ -433,6 +438,7 @@ uint8_t USB::dispatchPkt(uint8_t token, uint8_t ep, uint16_t nak_limit) {
         USBTRACE3("   - token ", token, 0x90);
         USBTRACE3("   - ep ", ep, 0x90);
         USBTRACE3("   - NAK limit ", nak_limit, 0x90);
+        USBEVENT(UHS_EV_DISPATCH, token | ep, nak_limit);
 
         while((int32_t)((uint32_t)millis() - timeout) < 0L) {
 #if defined(ESP8266) || defined(ESP32)
@@ -493,6 +499,16 @@ void USB::Task(void) //USB state machine
 
         tmpdata = getVbusState();
 
+#if ENABLE_UHS_EVENT_TRACE
+        static uint8_t lastVbus = 0xff;
+        uint8_t lastTaskState = usb_task_state;
+
+        if(tmpdata != lastVbus) {
+                USBEVENT(UHS_EV_VBUS, tmpdata, usb_task_state);
+                lastVbus = tmpdata;
+        }
+#endif
+
         /* modify USB task state if Vbus changed */
         switch(tmpdata) {
                 case SE1: //illegal state
@@ -587,6 +603,11 @@ void USB::Task(void) //USB state machine
                         //MAX3421E::Init();
                         break;
         } // switch( usb_task_state )
+
+#if ENABLE_UHS_EVENT_TRACE
+        if(usb_task_state != lastTaskState)
+                USBEVENT(UHS_EV_TASK_STATE, usb_task_state, lastTaskState);
+#endif
 }
 
 uint8_t USB::DefaultAddressing(uint8_t parent, uint8_t port, bool lowspeed) {
@@ -821,6 +842,16 @@ uint8_t USB::ReleaseDevice(uint8_t addr) {
         return 0;
 }
 
+/* Release every device and restart enumeration. If something is attached, Task() */
+/* goes straight on to settle and issue a bus reset.                              */
+void USB::ResetBus() {
+        for(uint8_t i = 0; i < USB_NUMDEVICES; i++)
+                if(devConfig[i])
+                        devConfig[i]->Release();
+
+        usb_task_state = USB_DETACHED_SUBSTATE_INITIALIZE;
+}
+
 #if 1 //!defined(USB_METHODS_INLINE)
 //get device descriptor
 
@@ -849,6 +880,7 @@ uint8_t USB::getConfDescr(uint8_t addr, uint8_t ep, uint8_t conf, USBReadParser
         uint16_t total = ucd->wTotalLength;
 
         USBTRACE3("\r\ntotal conf.size:", total, 0x80);
+        USBEVENT(UHS_EV_CONF_SIZE, conf, total);
 
         return ( ctrlReq(addr, ep, bmREQ_GET_DESCR, USB_REQUEST_GET_DESCRIPTOR, conf, USB_DESCRIPTOR_CONFIGURATION, 0x0000, total, bufSize, buf, p));
 }
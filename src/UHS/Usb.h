@@ -34,9 +34,11 @@ e-mail   :  support@circuitsathome.com
 #include "settings.h"
 #include "printhex.h"
 #include "message.h"
+#include "usbtrace.h"
 #include "hexdump.h"
 #include "sink_parser.h"
 #include "max3421e.h"
+#include "max3421e_model.h"
 #include "address.h"
 #include "avrpins.h"
 #include "usb_ch9.h"
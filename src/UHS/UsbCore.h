@@ -32,7 +32,9 @@ e-mail   :  support@circuitsathome.com
 //#define USB_METHODS_INLINE
 
 /* shield pins. First parameter - SS pin, second parameter - INT pin */
-#ifdef BOARD_BLACK_WIDDOW
+#if UHS_HOST_MODEL
+typedef MAX3421e<UhsModelPin, UhsModelPin> MAX3421E; // Register model, see max3421e_model.h
+#elif defined(BOARD_BLACK_WIDDOW)
 typedef MAX3421e<P6, P3> MAX3421E; // Black Widow
 #elif defined(CORE_TEENSY) && (defined(__AVR_AT90USB646__) || defined(__AVR_AT90USB1286__))
 #if EXT_RAM
@@ -268,6 +270,7 @@ public:
         uint8_t DefaultAddressing(uint8_t parent, uint8_t port, bool lowspeed);
         uint8_t Configuring(uint8_t parent, uint8_t port, bool lowspeed);
         uint8_t ReleaseDevice(uint8_t addr);
+        void ResetBus();
 
         uint8_t ctrlReq(uint8_t addr, uint8_t ep, uint8_t bmReqType, uint8_t bRequest, uint8_t wValLo, uint8_t wValHi,
                 uint16_t wInd, uint16_t total, uint16_t nbytes, uint8_t* dataptr, USBReadParser *p);
@@ -1636,6 +1636,9 @@ MAKE_PIN(P17, 17); // INT
 #endif
 #define pgm_read_pointer(p) pgm_read_ptr(p)
 
+#elif UHS_HOST_MODEL
+// Linux host build against the register model: no pins, the model uses UhsModelPin
+
 #else
 #error "Please define board in avrpins.h"
 
@@ -29,6 +29,7 @@ bHasReportId(false) {
                 pUsb->RegisterDeviceClass(this);
 }
 
+#if ENABLE_HID_REPORT_PARSING
 uint16_t HIDComposite::GetHidClassDescrLen(uint8_t type, uint8_t num) {
         for(uint8_t i = 0, n = 0; i < HID_MAX_HID_CLASS_DESCRIPTORS; i++) {
                 if(descrInfo[i].bDescrType == type) {
@@ -39,8 +40,10 @@ uint16_t HIDComposite::GetHidClassDescrLen(uint8_t type, uint8_t num) {
         }
         return 0;
 }
+#endif
 
 void HIDComposite::Initialize() {
+#if ENABLE_HID_REPORT_PARSING
         for(uint8_t i = 0; i < MAX_REPORT_PARSERS; i++) {
                 rptParsers[i].rptId = 0;
                 rptParsers[i].rptParser = NULL;
@@ -49,6 +52,7 @@ void HIDComposite::Initialize() {
                 descrInfo[i].bDescrType = 0;
                 descrInfo[i].wDescriptorLength = 0;
         }
+#endif
         for(uint8_t i = 0; i < maxHidInterfaces; i++) {
                 hidInterfaces[i].bmInterface = 0;
                 hidInterfaces[i].bmProtocol = 0;
@@ -69,6 +73,7 @@ void HIDComposite::Initialize() {
         pollInterval = 0;
 }
 
+#if ENABLE_HID_REPORT_PARSING
 bool HIDComposite::SetReportParser(uint8_t id, HIDReportParser *prs) {
         for(uint8_t i = 0; i < MAX_REPORT_PARSERS; i++) {
                 if(rptParsers[i].rptId == 0 && rptParsers[i].rptParser == NULL) {
@@ -90,6 +95,7 @@ HIDReportParser* HIDComposite::GetReportParser(uint8_t id) {
         }
         return NULL;
 }
+#endif
 
 uint8_t HIDComposite::Init(uint8_t parent, uint8_t port, bool lowspeed) {
         const uint8_t constBufSize = sizeof (USB_DEVICE_DESCRIPTOR);
@@ -238,6 +244,7 @@ uint8_t HIDComposite::Init(uint8_t parent, uint8_t port, bool lowspeed) {
                 rcode = SetIdle(hidInterfaces[i].bmInterface, 0, 0);
 
                 USBTRACE3("  -- Returned ", rcode, 0x80);
+                USBEVENT(UHS_EV_HID_SETIDLE, hidInterfaces[i].bmInterface, rcode);
 
                 if(rcode && rcode != hrSTALL)
                         goto FailSetIdle;
@@ -245,9 +252,10 @@ uint8_t HIDComposite::Init(uint8_t parent, uint8_t port, bool lowspeed) {
 
         USBTRACE("HU configured\r\n");
 
-        OnInitSuccessful();
-
+        // Ready before the init callback, so that the driver reads as connected in it
         bPollEnable = true;
+
+        OnInitSuccessful();
         return 0;
 
 FailGetDevDescr:
@@ -391,6 +399,9 @@ uint8_t HIDComposite::Poll() {
 
                         uint8_t rcode = pUsb->inTransfer(bAddress, epInfo[index].epAddr, &read, buf);
 
+                        if(rcode != hrNAK)
+                                USBEVENT(UHS_EV_HID_POLL, i, (rcode << 8) | (rcode ? 0 : (uint8_t)read));
+
                         if(rcode) {
                                 if(rcode != hrNAK)
                                         USBTRACE3("(hidcomposite.h) Poll:", rcode, 0x81);
@@ -415,10 +426,12 @@ uint8_t HIDComposite::Poll() {
 #endif
                         ParseHIDData(this, epInfo[index].epAddr, bHasReportId, (uint8_t)read, buf);
 
+#if ENABLE_HID_REPORT_PARSING
                         HIDReportParser *prs = GetReportParser(((bHasReportId) ? *buf : 0));
 
                         if(prs)
                                 prs->Parse(this, bHasReportId, (uint8_t)read, buf);
+#endif
                     }
 
         }
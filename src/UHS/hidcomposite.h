@@ -25,6 +25,7 @@ class HIDComposite : public USBHID {
 
 protected:
 
+#if ENABLE_HID_REPORT_PARSING
         struct ReportParser {
                 uint8_t rptId;
                 HIDReportParser *rptParser;
@@ -35,6 +36,7 @@ protected:
 
         // Returns HID class specific descriptor length by its type and order number
         uint16_t GetHidClassDescrLen(uint8_t type, uint8_t num);
+#endif
 
         struct HIDInterface {
                 struct {
@@ -70,8 +72,10 @@ protected:
 
         uint16_t PID, VID; // PID and VID of connected device
 
+#if ENABLE_HID_REPORT_PARSING
         // HID implementation
         HIDReportParser* GetReportParser(uint8_t id);
+#endif
 
         virtual uint8_t OnInitSuccessful() {
                 return 0;
@@ -84,8 +88,10 @@ protected:
 public:
         HIDComposite(USB *p);
 
+#if ENABLE_HID_REPORT_PARSING
         // HID implementation
         bool SetReportParser(uint8_t id, HIDReportParser *prs);
+#endif
 
         // USBDeviceConfig implementation
         uint8_t Init(uint8_t parent, uint8_t port, bool lowspeed);
@@ -17,6 +17,8 @@ e-mail   :  support@circuitsathome.com
 
 #include "hidescriptorparser.h"
 
+#if ENABLE_HID_REPORT_PARSING
+
 const char * const ReportDescParserBase::usagePageTitles0[] PROGMEM = {
         pstrUsagePageGenericDesktopControls,
         pstrUsagePageSimulationControls,
@@ -1592,3 +1594,5 @@ void UniversalReportParser::Parse(USBHID *hid, bool is_rpt_id __attribute__((unu
         if(ret)
                 ErrorMessage<uint8_t > (PSTR("GetReportDescr-2"), ret);
 }
+
+#endif // ENABLE_HID_REPORT_PARSING
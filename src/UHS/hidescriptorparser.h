@@ -19,6 +19,8 @@ e-mail   :  support@circuitsathome.com
 
 #include "usbhid.h"
 
+#if ENABLE_HID_REPORT_PARSING
+
 class ReportDescParserBase : public USBReadParser {
 public:
         typedef void (*UsagePageFunc)(uint16_t usage);
@@ -173,4 +175,6 @@ public:
         virtual void Parse(USBHID *hid, bool is_rpt_id, uint8_t len, uint8_t *buf);
 };
 
+#endif // ENABLE_HID_REPORT_PARSING
+
 #endif // __HIDDESCRIPTORPARSER_H__
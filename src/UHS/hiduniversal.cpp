@@ -17,14 +17,36 @@ e-mail   :  support@circuitsathome.com
 
 #include "hiduniversal.h"
 
+void HIDUniversal::ExpectResponse() const {
+        if(respPending < 0xFF)
+                respPending++;
+        respDeadline = (uint32_t)millis() + respTimeout;
+        idleInterval = 0;
+}
+
+uint16_t HIDUniversal::NextPollInterval() const {
+        if(respPending)
+                return respPollInterval;
+        if(!idleInterval)
+                return pollInterval;
+        return idleInterval;
+}
+
 uint8_t HIDUniversal::Poll() {
         uint8_t rcode = 0;
 
         if(!bPollEnable)
                 return 0;
 
-        if((int32_t)((uint32_t)millis() - qNextPollTime) >= 0L) {
-                qNextPollTime = (uint32_t)millis() + pollInterval;
+        uint32_t now = (uint32_t)millis();
+
+        if(respPending && (int32_t)(now - respDeadline) >= 0L) {
+                pollStats.timeouts += respPending;
+                respPending = 0;
+        }
+
+        if((uint32_t)(now - lastPollTime) >= NextPollInterval()) {
+                lastPollTime = now;
 
                 uint8_t buf[constBuffLen];
 
@@ -32,31 +54,49 @@ uint8_t HIDUniversal::Poll() {
                         uint8_t index = hidInterfaces[i].epIndex[epInterruptInIndex];
                         uint16_t read = (uint16_t)epInfo[index].maxPktSize;
 
-                        ZeroMemory(constBuffLen, buf);
-
                         USBTRACE1("  => Poll:\r\n", 0x90);
                         USBTRACE3("     - interface ", i, 0x90);
                         USBTRACE3("     - index ", index, 0x90);
                         USBTRACE3("     - address ", bAddress, 0x90);
                         USBTRACE3("     - epAddr ", epInfo[index].epAddr, 0x90);
 
+                        pollStats.polls++;
                         uint8_t rcode = pUsb->inTransfer(bAddress, epInfo[index].epAddr, &read, buf);
 
                         USBTRACE3("   Returned ", rcode, 0x90);
+                        if(rcode != hrNAK)
+                                USBEVENT(UHS_EV_HID_POLL, i, (rcode << 8) | (rcode ? 0 : (uint8_t)read));
 
                         if(rcode) {
-                                if(rcode != hrNAK)
+                                if(rcode != hrNAK) {
+                                        pollStats.errors++;
                                         USBTRACE3("(hiduniversal.h) Poll:", rcode, 0x81);
+                                } else {
+                                        pollStats.naks++;
+                                        // Nothing outstanding and the device keeps NAKing: poll less often
+                                        if(!respPending && ++nakRun >= idleNakThreshold) {
+                                                nakRun = 0;
+                                                uint16_t base = pollInterval ? pollInterval : 1;
+                                                idleInterval = idleInterval ? idleInterval * 2 : base * 2;
+                                                if(idleInterval > idlePollMax)
+                                                        idleInterval = idlePollMax;
+                                        }
+                                }
                                 return rcode;
                         }
 
+                        // A zero-length report carries nothing to parse
+                        if(read == 0)
+                                continue;
+
                         if(read > constBuffLen)
                                 read = constBuffLen;
 
-                        // TODO: handle read == 0 ? continue like HIDComposite,
-                        //       return early like in the error case above?
-                        //       Either way passing an empty buffer to the functions below
-                        //       probably makes no sense?
+                        pollStats.reports++;
+                        nakRun = 0;
+                        idleInterval = 0;
+                        if(respPending)
+                                respPending--;
 
 #if 0
                         Notify(PSTR("\r\nBuf: "), 0x80);
@@ -68,12 +108,15 @@ uint8_t HIDUniversal::Poll() {
 
                         Notify(PSTR("\r\n"), 0x80);
 #endif
+                        // buf is not cleared between polls; only the first `read` bytes are valid
                         ParseHIDData(this, bHasReportId, (uint8_t)read, buf);
 
+#if ENABLE_HID_REPORT_PARSING
                         HIDReportParser *prs = GetReportParser(((bHasReportId) ? *buf : 0));
 
                         if(prs)
                                 prs->Parse(this, bHasReportId, (uint8_t)read, buf);
+#endif
                 }
         }
         return rcode;
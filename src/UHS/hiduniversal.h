@@ -41,11 +41,56 @@ protected:
                 return;
         }
 
+        // Adaptive interrupt-IN scheduling. A driver that knows a report is coming
+        // (e.g. after sending a request on the OUT endpoint) calls ExpectResponse();
+        // Poll() then runs every respPollInterval, however long the endpoint's
+        // bInterval, until a report arrives or respTimeout expires. With nothing
+        // outstanding it runs at bInterval, and the idle interval doubles after
+        // every idleNakThreshold consecutive NAKs, up to idlePollMax. On an endpoint
+        // with a 1 ms bInterval, such as the MiniDSP's, responses come no sooner; what
+        // it saves there is the SPI traffic of idle polls. Only a longer bInterval
+        // gets lower latency as well.
+        static const uint16_t respPollInterval = 1; // ms
+        static const uint8_t idleNakThreshold = 4;
+        static const uint16_t idlePollMax = 64; // ms
+        static const uint16_t respTimeout = 100; // ms
+
+        void ExpectResponse() const;
+
 public:
+        struct PollStats {
+                uint32_t polls;         // IN transfers attempted
+                uint32_t reports;       // IN transfers that returned data
+                uint32_t naks;          // IN transfers answered with NAK
+                uint32_t errors;        // IN transfers that failed otherwise
+                uint32_t timeouts;      // expected responses that never arrived
+        };
+
         HIDUniversal(USB *p) : HIDComposite(p) {}
 
         uint8_t Poll() override;
 
+        const PollStats& GetPollStats() const {
+                return pollStats;
+        }
+
+        void ResetPollStats() {
+                pollStats = PollStats();
+        }
+
+        // True while a request sent with ExpectResponse() hasn't been answered or timed out
+        bool ResponsePending() const {
+                return respPending != 0;
+        }
+
+        uint8_t Release() override {
+                respPending = 0;
+                idleInterval = 0;
+                nakRun = 0;
+                lastPollTime = 0;
+                return HIDComposite::Release();
+        }
+
         // UsbConfigXtracter implementation
         void EndpointXtract(uint8_t conf, uint8_t iface, uint8_t alt, uint8_t proto, const USB_ENDPOINT_DESCRIPTOR *ep) override
         {
@@ -55,6 +100,18 @@ public:
                 // otherwise HIDComposite does what HIDUniversal needs
                 HIDComposite::EndpointXtract(conf, iface, alt, proto, ep);
         }
+
+private:
+        // Scheduling state is touched from const request methods via ExpectResponse()
+        mutable uint8_t respPending = 0; // requests sent whose response hasn't been read
+        mutable uint32_t respDeadline = 0;
+        mutable uint16_t idleInterval = 0; // current idle poll interval, 0 = not yet backed off
+        uint8_t nakRun = 0; // consecutive NAKs while idle
+        uint32_t lastPollTime = 0;
+
+        PollStats pollStats = {};
+
+        uint16_t NextPollInterval() const;
 };
 
 #endif // __HIDUNIVERSAL_H__
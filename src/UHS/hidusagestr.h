@@ -19,6 +19,8 @@ e-mail   :  support@circuitsathome.com
 
 #include "Usb.h"
 
+#if ENABLE_HID_REPORT_PARSING
+
 const char pstrSpace [] PROGMEM = " ";
 const char pstrCRLF [] PROGMEM = "\r\n";
 const char pstrSingleTab [] PROGMEM = "\t";
@@ -974,4 +976,6 @@ const char pstrUsageSoftControlAdjust [] PROGMEM = "Soft Ctrl Adj";
 //const char *medInstrTitles3[];
 //const char *medInstrTitles4[];
 
+#endif // ENABLE_HID_REPORT_PARSING
+
 #endif //__HIDUSAGESTR_H__
@@ -19,6 +19,8 @@ e-mail   :  support@circuitsathome.com
 
 #include "hidusagestr.h"
 
+#if ENABLE_HID_REPORT_PARSING
+
 // This is here why?
 
 //const char *usagePageTitles0[]	PROGMEM =
@@ -1045,4 +1047,6 @@ e-mail   :  support@circuitsathome.com
 //	pstrUsageSoftControlAdjust
 //};
 
+#endif // ENABLE_HID_REPORT_PARSING
+
 #endif // __HIDUSAGETITLEARRAYS_H__
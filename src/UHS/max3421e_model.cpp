@@ -0,0 +1,621 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+
+#include "Usb.h"
+#include "usbhub.h"
+
+#if UHS_HOST_MODEL
+
+#define MODEL_FRAME_NS 1000000ULL
+
+/* Scripted device */
+
+bool UhsScriptedDevice::queueReport(uint8_t ep, const uint8_t *buf, uint8_t len, uint32_t latencyUs) {
+        if(qCount >= maxQueued || len > sizeof (queue[0].data))
+                return false;
+        Report &r = queue[qCount++];
+        r.readyNs = UhsModel::instance().nanos() + (uint64_t)latencyUs * 1000;
+        r.ep = ep;
+        r.len = len;
+        memcpy(r.data, buf, len);
+        return true;
+}
+
+uint8_t UhsScriptedDevice::control(const uint8_t *setup, uint8_t *reply, uint16_t *len) {
+        uint8_t bmReqType = setup[0];
+        uint8_t bRequest = setup[1];
+        uint8_t descrType = setup[3];
+
+        // Class and vendor requests (SET_IDLE, SET_PROTOCOL, ...) are accepted and ignored
+        if(bmReqType & 0x60) {
+                *len = 0;
+                return hrSUCCESS;
+        }
+
+        switch(bRequest) {
+                case USB_REQUEST_GET_DESCRIPTOR:
+                {
+                        const uint8_t *p;
+                        uint16_t n;
+                        if(descrType == USB_DESCRIPTOR_DEVICE) {
+                                p = devDescr;
+                                n = devDescr[0];
+                        } else if(descrType == USB_DESCRIPTOR_CONFIGURATION) {
+                                p = confDescr;
+                                n = confLen;
+                        } else
+                                return hrSTALL;
+                        if(n > *len)
+                                n = *len;
+                        memcpy(reply, p, n);
+                        *len = n;
+                        return hrSUCCESS;
+                }
+                case USB_REQUEST_SET_CONFIGURATION:
+                        bConfiguration = setup[2];
+                        *len = 0;
+                        return hrSUCCESS;
+                case USB_REQUEST_GET_CONFIGURATION:
+                        reply[0] = bConfiguration;
+                        *len = 1;
+                        return hrSUCCESS;
+                case USB_REQUEST_GET_STATUS:
+                        reply[0] = reply[1] = 0;
+                        *len = 2;
+                        return hrSUCCESS;
+                case USB_REQUEST_CLEAR_FEATURE:
+                case USB_REQUEST_SET_FEATURE:
+                case USB_REQUEST_SET_INTERFACE:
+                        *len = 0;
+                        return hrSUCCESS;
+                default:
+                        return hrSTALL;
+        }
+}
+
+uint8_t UhsScriptedDevice::in(uint8_t ep, uint8_t *buf, uint8_t *len) {
+        uint64_t now = UhsModel::instance().nanos();
+        for(uint8_t i = 0; i < qCount; i++) {
+                if(queue[i].ep != ep)
+                        continue;
+                // Reports on one endpoint come out in order, so an unready one blocks the rest
+                if(queue[i].readyNs > now)
+                        return hrNAK;
+                uint8_t n = (queue[i].len < *len) ? queue[i].len : *len;
+                memcpy(buf, queue[i].data, n);
+                *len = n;
+                qCount--;
+                memmove(&queue[i], &queue[i + 1], (qCount - i) * sizeof (Report));
+                return hrSUCCESS;
+        }
+        return hrNAK;
+}
+
+uint8_t UhsScriptedDevice::out(uint8_t ep, const uint8_t *buf, uint8_t len) {
+        if(onOut != nullptr)
+                onOut(*this, ep, buf, len);
+        return hrSUCCESS;
+}
+
+void UhsScriptedDevice::busReset() {
+        bConfiguration = 0;
+        qCount = 0;
+}
+
+/* Hub */
+
+static const uint8_t hubDevDescr[] = {
+        18, USB_DESCRIPTOR_DEVICE, 0x00, 0x02, USB_CLASS_HUB, 0x00, 0x00, 64,
+        0x24, 0x04, 0x14, 0x25, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static const uint8_t hubConfDescr[] = {
+        9, USB_DESCRIPTOR_CONFIGURATION, 25, 0, 1, 1, 0, 0xe0, 1,
+        9, USB_DESCRIPTOR_INTERFACE, 0, 0, 1, USB_CLASS_HUB, 0, 0, 0,
+        7, USB_DESCRIPTOR_ENDPOINT, 0x81, USB_TRANSFER_TYPE_INTERRUPT, 1, 0, 12
+};
+
+UhsModelHub::UhsModelHub() : UhsScriptedDevice(hubDevDescr, hubConfDescr, sizeof (hubConfDescr)) {
+}
+
+void UhsModelHub::plug(uint8_t port, UhsModelDevice *dev) {
+        if(port < 1 || port > numPorts)
+                return;
+        Port &p = ports[port - 1];
+        p.device = dev;
+        p.status &= ~bmHUB_PORT_STATUS_PORT_ENABLE;
+        if(p.status & bmHUB_PORT_STATUS_PORT_POWER) {
+                p.status |= bmHUB_PORT_STATUS_PORT_CONNECTION;
+                p.change |= bmHUB_PORT_STATUS_C_PORT_CONNECTION;
+        }
+}
+
+void UhsModelHub::unplug(uint8_t port) {
+        if(port < 1 || port > numPorts)
+                return;
+        Port &p = ports[port - 1];
+        if(p.status & bmHUB_PORT_STATUS_PORT_CONNECTION)
+                p.change |= bmHUB_PORT_STATUS_C_PORT_CONNECTION;
+        p.device = nullptr;
+        p.status &= ~(bmHUB_PORT_STATUS_PORT_CONNECTION | bmHUB_PORT_STATUS_PORT_ENABLE);
+}
+
+void UhsModelHub::setPortFeature(Port &p, uint8_t feature) {
+        switch(feature) {
+                case HUB_FEATURE_PORT_POWER:
+                        if(!(p.status & bmHUB_PORT_STATUS_PORT_POWER) && p.device != nullptr) {
+                                p.status |= bmHUB_PORT_STATUS_PORT_CONNECTION;
+                                p.change |= bmHUB_PORT_STATUS_C_PORT_CONNECTION;
+                        }
+                        p.status |= bmHUB_PORT_STATUS_PORT_POWER;
+                        break;
+                case HUB_FEATURE_PORT_RESET:
+                        if(p.status & bmHUB_PORT_STATUS_PORT_CONNECTION) {
+                                p.device->address = 0;
+                                p.device->busReset();
+                                p.status |= bmHUB_PORT_STATUS_PORT_ENABLE;
+                                p.change |= bmHUB_PORT_STATUS_C_PORT_RESET;
+                        }
+                        break;
+                default:
+                        break;
+        }
+}
+
+void UhsModelHub::clearPortFeature(Port &p, uint8_t feature) {
+        if(feature >= HUB_FEATURE_C_PORT_CONNECTION) {
+                p.change &= ~(1 << (feature - HUB_FEATURE_C_PORT_CONNECTION));
+                return;
+        }
+        switch(feature) {
+                case HUB_FEATURE_PORT_ENABLE:
+                        p.status &= ~bmHUB_PORT_STATUS_PORT_ENABLE;
+                        break;
+                case HUB_FEATURE_PORT_POWER:
+                        p.status = 0;
+                        break;
+                default:
+                        break;
+        }
+}
+
+uint8_t UhsModelHub::control(const uint8_t *setup, uint8_t *reply, uint16_t *len) {
+        uint8_t bmReqType = setup[0];
+        uint8_t bRequest = setup[1];
+        uint8_t feature = setup[2];
+        uint8_t port = setup[4];
+
+        if((bmReqType & 0x60) != USB_SETUP_TYPE_CLASS)
+                return UhsScriptedDevice::control(setup, reply, len);
+
+        bool toPort = (bmReqType & 0x1f) == USB_SETUP_RECIPIENT_OTHER;
+        if(toPort && (port < 1 || port > numPorts))
+                return hrSTALL;
+        Port &p = ports[toPort ? port - 1 : 0];
+
+        switch(bRequest) {
+                case USB_REQUEST_GET_DESCRIPTOR:
+                {
+                        const uint8_t descr[] = {9, 0x29, numPorts, 0x09, 0x00, 50, 100, 0x00, 0xff};
+                        uint16_t n = (sizeof (descr) < *len) ? sizeof (descr) : *len;
+                        memcpy(reply, descr, n);
+                        *len = n;
+                        return hrSUCCESS;
+                }
+                case USB_REQUEST_GET_STATUS:
+                {
+                        uint16_t status = toPort ? p.status : 0;
+                        uint16_t change = toPort ? p.change : 0;
+                        uint8_t st[4] = {(uint8_t)status, (uint8_t)(status >> 8), (uint8_t)change, (uint8_t)(change >> 8)};
+                        uint16_t n = (*len < 4) ? *len : 4;
+                        memcpy(reply, st, n);
+                        *len = n;
+                        return hrSUCCESS;
+                }
+                case USB_REQUEST_SET_FEATURE:
+                        if(toPort)
+                                setPortFeature(p, feature);
+                        *len = 0;
+                        return hrSUCCESS;
+                case USB_REQUEST_CLEAR_FEATURE:
+                        if(toPort)
+                                clearPortFeature(p, feature);
+                        *len = 0;
+                        return hrSUCCESS;
+                default:
+                        return hrSTALL;
+        }
+}
+
+uint8_t UhsModelHub::in(uint8_t ep, uint8_t *buf, uint8_t *len) {
+        if(ep != 1 || *len < 1)
+                return hrSTALL;
+        // Status change bitmap: bit 0 is the hub itself, bit n is port n
+        uint8_t bitmap = 0;
+        for(uint8_t i = 0; i < numPorts; i++)
+                if(ports[i].change)
+                        bitmap |= 2 << i;
+        if(!bitmap)
+                return hrNAK;
+        buf[0] = bitmap;
+        *len = 1;
+        return hrSUCCESS;
+}
+
+uint8_t UhsModelHub::out(uint8_t ep __attribute__((unused)), const uint8_t *buf __attribute__((unused)), uint8_t len __attribute__((unused))) {
+        return hrSTALL;
+}
+
+void UhsModelHub::busReset() {
+        UhsScriptedDevice::busReset();
+        // Ports lose power; what is plugged in stays plugged in
+        for(uint8_t i = 0; i < numPorts; i++) {
+                ports[i].status = ports[i].change = 0;
+                if(ports[i].device != nullptr) {
+                        ports[i].device->address = 0;
+                        ports[i].device->busReset();
+                }
+        }
+}
+
+UhsModelDevice *UhsModelHub::downstream(uint8_t port) {
+        if(port < 1 || port > numPorts)
+                return nullptr;
+        Port &p = ports[port - 1];
+        return (p.status & bmHUB_PORT_STATUS_PORT_ENABLE) ? p.device : nullptr;
+}
+
+/* Bus */
+
+void UhsModel::attach(UhsModelDevice *dev) {
+        bool wasOnBus = deviceOnBus();
+        device = dev;
+        if(dev != nullptr)
+                dev->address = 0;
+        if(deviceOnBus() != wasOnBus)
+                hirq |= bmCONDETIRQ;
+}
+
+void UhsModel::detach() {
+        bool wasOnBus = deviceOnBus();
+        device = nullptr;
+        if(wasOnBus)
+                hirq |= bmCONDETIRQ;
+}
+
+bool UhsModel::deviceOnBus() const {
+        return device != nullptr && !(vbusOff && device->busPowered());
+}
+
+/* The device answering to addr: the root device, or one behind a hub */
+UhsModelDevice *UhsModel::route(UhsModelDevice *dev, uint8_t addr) {
+        if(dev == nullptr)
+                return nullptr;
+        if(dev->address == addr)
+                return dev;
+        for(uint8_t port = 1; port <= UhsModelHub::numPorts; port++) {
+                UhsModelDevice *found = route(dev->downstream(port), addr);
+                if(found != nullptr)
+                        return found;
+        }
+        return nullptr;
+}
+
+uint8_t UhsModel::busState() const {
+        if(!deviceOnBus() || (hctl & bmBUSRST))
+                return bmSE0;
+        // J is the idle state for the speed the host is set to; a device of the other speed idles in K
+        bool modeLs = (mode & bmLOWSPEED) != 0;
+        return (device->lowSpeed() == modeLs) ? bmJSTATUS : bmKSTATUS;
+}
+
+/* Chip */
+
+void UhsModel::chipReset() {
+        // CHIPRES resets everything except PINCTL and USBCTL
+        hirq = hien = mode = hctl = hrsl = peraddr = 0;
+        usbirq = cpuctl = iopins1 = iopins2 = 0;
+        sudPos = sndPos = sndbc = rcvPos = rcvbc = 0;
+        rcvTog = sndTog = false;
+        xferBusy = false;
+        xferDoneNs = busResetDoneNs = frameNs = now;
+}
+
+void UhsModel::spiCost(uint8_t nbytes) {
+        // Command byte plus data
+        uint64_t ns = timing.spiSetupNs + (uint64_t)(nbytes + 1) * timing.spiByteNs;
+        now += ns;
+        stats.spiAccesses++;
+        stats.spiBytes += nbytes + 1;
+        stats.spiNs += ns;
+}
+
+void UhsModel::update() {
+        if(xferBusy && now >= xferDoneNs) {
+                xferBusy = false;
+                hrsl = xferResult;
+                hirq |= bmHXFRDNIRQ;
+                if(xferRcv)
+                        hirq |= bmRCVDAVIRQ;
+        }
+        if((hctl & bmBUSRST) && now >= busResetDoneNs) {
+                hctl &= ~bmBUSRST;
+                hirq |= bmBUSEVENTIRQ;
+                frameNs = now;
+        }
+        if((mode & bmSOFKAENAB) && deviceOnBus()) {
+                if(now >= frameNs + MODEL_FRAME_NS) {
+                        frameNs += ((now - frameNs) / MODEL_FRAME_NS) * MODEL_FRAME_NS;
+                        hirq |= bmFRAMEIRQ;
+                }
+        } else
+                frameNs = now;
+}
+
+/* Run one HXFR token against the device. The result shows up in HRSL and
+ * HIRQ once the bus time it would take has passed. */
+void UhsModel::launch(uint8_t hxfr) {
+        uint8_t token = hxfr & 0xf0;
+        uint8_t ep = hxfr & 0x0f;
+        uint32_t byteNs = (mode & bmLOWSPEED) ? timing.byteNs * 8 : timing.byteNs;
+        uint8_t rcode = hrSUCCESS;
+        uint8_t nbytes = 0;
+
+        stats.transfers++;
+        xferRcv = false;
+
+        UhsModelDevice *dev = (deviceOnBus() && !(hctl & bmBUSRST)) ? route(device, peraddr) : nullptr;
+
+        if(dev == nullptr) {
+                rcode = hrTIMEOUT;
+        } else if(token == tokSETUP) {
+                nbytes = 8;
+                ctrlLen = ctrlPos = 0;
+                ctrlStall = false;
+                target = dev;
+                addressPending = false;
+                if(sudFifo[0] == 0x00 && sudFifo[1] == USB_REQUEST_SET_ADDRESS) {
+                        // Takes effect after the status stage
+                        pendingAddress = sudFifo[2];
+                        addressPending = true;
+                } else {
+                        uint16_t wLength = sudFifo[6] | (sudFifo[7] << 8);
+                        uint16_t len = (sudFifo[0] & 0x80) ? ((wLength < sizeof (ctrlBuf)) ? wLength : sizeof (ctrlBuf)) : 0;
+                        ctrlStall = (dev->control(sudFifo, ctrlBuf, &len) == hrSTALL);
+                        ctrlLen = len;
+                }
+        } else if(ep == 0 && (token == tokIN || token == tokOUT)) {
+                if(ctrlStall)
+                        rcode = hrSTALL;
+                else if(token == tokIN) {
+                        uint16_t left = ctrlLen - ctrlPos;
+                        nbytes = (left < dev->maxPacket0()) ? left : dev->maxPacket0();
+                        memcpy(rcvFifo, ctrlBuf + ctrlPos, nbytes);
+                        ctrlPos += nbytes;
+                        rcvbc = nbytes;
+                        rcvPos = 0;
+                        xferRcv = true;
+                        rcvTog = !rcvTog;
+                } else {
+                        nbytes = sndbc;
+                        sndTog = !sndTog;
+                }
+        } else if(token == tokINHS || token == tokOUTHS) {
+                if(ctrlStall)
+                        rcode = hrSTALL;
+                else if(addressPending && dev == target) {
+                        dev->address = pendingAddress;
+                        addressPending = false;
+                }
+        } else if(token == tokIN) {
+                uint8_t len = sizeof (rcvFifo);
+                rcode = dev->in(ep, rcvFifo, &len);
+                if(rcode == hrSUCCESS) {
+                        nbytes = len;
+                        rcvbc = len;
+                        rcvPos = 0;
+                        xferRcv = true;
+                        rcvTog = !rcvTog;
+                }
+        } else if(token == tokOUT) {
+                nbytes = sndbc;
+                rcode = dev->out(ep, sndFifo, sndbc);
+                if(rcode == hrSUCCESS)
+                        sndTog = !sndTog;
+        } else
+                rcode = hrBADREQ;
+
+        uint64_t busNs = (rcode == hrTIMEOUT) ? timing.timeoutNs : timing.tokenNs + (uint64_t)nbytes * byteNs;
+        if(rcode == hrNAK)
+                stats.naks++;
+        stats.busNs += busNs;
+
+        xferResult = rcode;
+        xferBusy = true;
+        xferDoneNs = now + busNs;
+        hrsl = hrBUSY;
+}
+
+/* Register interface */
+
+void UhsModel::regWr(uint8_t reg, uint8_t data) {
+        spiCost(1);
+        update();
+
+        switch(reg) {
+                case rSUDFIFO:
+                        if(sudPos < sizeof (sudFifo))
+                                sudFifo[sudPos++] = data;
+                        break;
+                case rSNDFIFO:
+                        if(sndPos < sizeof (sndFifo))
+                                sndFifo[sndPos++] = data;
+                        break;
+                case rSNDBC:
+                        // Commits the FIFO; the next write refills it from the start
+                        sndbc = (data > sizeof (sndFifo)) ? sizeof (sndFifo) : data;
+                        sndPos = 0;
+                        break;
+                case rUSBCTL:
+                        if(data & bmCHIPRES)
+                                chipReset();
+                        else if(usbctl & bmCHIPRES)
+                                usbirq |= bmOSCOKIRQ;
+                        usbctl = data;
+                        break;
+                case rUSBIRQ:
+                        usbirq &= ~data;
+                        break;
+                case rCPUCTL:
+                        cpuctl = data;
+                        break;
+                case rPINCTL:
+                {
+                        bool wasOnBus = deviceOnBus();
+                        pinctl = data;
+                        vbusOff = ((data & (bmGPXA | bmGPXB)) == GPX_VBDET);
+                        if(deviceOnBus() != wasOnBus) {
+                                hirq |= bmCONDETIRQ;
+                                device->address = 0;
+                                if(deviceOnBus())
+                                        device->busReset();
+                        }
+                        break;
+                }
+                case rIOPINS1:
+                        iopins1 = data;
+                        break;
+                case rIOPINS2:
+                        iopins2 = data;
+                        break;
+                case rHIRQ:
+                        hirq &= ~data;
+                        break;
+                case rHIEN:
+                        hien = data;
+                        break;
+                case rMODE:
+                        mode = data;
+                        break;
+                case rPERADDR:
+                        peraddr = data;
+                        break;
+                case rHCTL:
+                        if(data & bmBUSRST) {
+                                hctl |= bmBUSRST;
+                                busResetDoneNs = now + timing.busResetNs;
+                                addressPending = false;
+                                if(device != nullptr) {
+                                        device->address = 0;
+                                        device->busReset();
+                                }
+                        }
+                        if(data & bmFRMRST)
+                                frameNs = now;
+                        if(data & bmSAMPLEBUS)
+                                hctl |= bmSAMPLEBUS; // sampling is instant here
+                        if(data & bmRCVTOG0)
+                                rcvTog = false;
+                        if(data & bmRCVTOG1)
+                                rcvTog = true;
+                        if(data & bmSNDTOG0)
+                                sndTog = false;
+                        if(data & bmSNDTOG1)
+                                sndTog = true;
+                        break;
+                case rHXFR:
+                        sudPos = 0;
+                        launch(data);
+                        break;
+                default:
+                        break;
+        }
+}
+
+uint8_t UhsModel::regRd(uint8_t reg) {
+        spiCost(1);
+        update();
+
+        switch(reg) {
+                case rRCVFIFO:
+                        return (rcvPos < rcvbc) ? rcvFifo[rcvPos++] : 0;
+                case rRCVBC:
+                        return rcvbc;
+                case rSNDBC:
+                        return sndbc;
+                case rUSBIRQ:
+                        return usbirq;
+                case rUSBCTL:
+                        return usbctl;
+                case rCPUCTL:
+                        return cpuctl;
+                case rPINCTL:
+                        return pinctl;
+                case rREVISION:
+                        return 0x13;
+                case rIOPINS1:
+                        return iopins1;
+                case rIOPINS2:
+                        return iopins2;
+                case rHIRQ:
+                        return hirq;
+                case rHIEN:
+                        return hien;
+                case rMODE:
+                        return mode;
+                case rPERADDR:
+                        return peraddr;
+                case rHCTL:
+                        return hctl;
+                case rHRSL:
+                        return (hrsl & 0x0f) | (rcvTog ? bmRCVTOGRD : 0) | (sndTog ? bmSNDTOGRD : 0) | busState();
+                default:
+                        return 0;
+        }
+}
+
+void UhsModel::bytesWr(uint8_t reg, uint8_t nbytes, const uint8_t *data) {
+        spiCost(nbytes);
+        update();
+
+        uint8_t *fifo;
+        uint8_t *pos;
+        uint8_t size;
+        if(reg == rSUDFIFO) {
+                fifo = sudFifo;
+                pos = &sudPos;
+                size = sizeof (sudFifo);
+        } else if(reg == rSNDFIFO) {
+                fifo = sndFifo;
+                pos = &sndPos;
+                size = sizeof (sndFifo);
+        } else
+                return;
+
+        while(nbytes-- && *pos < size)
+                fifo[(*pos)++] = *data++;
+}
+
+void UhsModel::bytesRd(uint8_t reg, uint8_t nbytes, uint8_t *data) {
+        spiCost(nbytes);
+        update();
+
+        while(nbytes--)
+                *data++ = (reg == rRCVFIFO && rcvPos < rcvbc) ? rcvFifo[rcvPos++] : 0;
+}
+
+#endif // UHS_HOST_MODEL
@@ -0,0 +1,304 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+#if !defined(_usb_h_) || defined(__MAX3421E_MODEL_H__)
+#error "Never include max3421e_model.h directly; include Usb.h instead"
+#else
+#define __MAX3421E_MODEL_H__
+
+#if UHS_HOST_MODEL
+
+/*
+ * Software model of the MAX3421E host register file, for running the UHS
+ * stack in a Linux process (see tools/uhs_host).
+ *
+ * With UHS_HOST_MODEL set, MAX3421e<>::regWr/regRd/bytesWr/bytesRd talk to
+ * UhsModel::instance() instead of SPI, so everything above them - Init,
+ * busprobe, USB::Task, enumeration, HIDUniversal::Poll, MiniDSP - runs
+ * unmodified. The model keeps its own clock: every register access costs SPI
+ * time and every transfer costs bus time, and the host's millis()/micros()
+ * are expected to read that clock, so busy-waits in the stack advance it.
+ *
+ * Modelled: HIRQ (write-1-to-clear, HXFRDN, RCVDAV, CONDET, FRAME), HRSL
+ * (result, J/K, toggles), HXFR, HCTL (BUSRST, SAMPLEBUS, toggles), PERADDR,
+ * MODE, SUD/SND/RCV FIFOs and byte counts, USBCTL/USBIRQ reset and OSCOK,
+ * and GPX VBUS switching, and hubs (UhsModelHub) for full-speed devices.
+ * Not modelled: low-speed devices behind a hub, ISO, suspend/resume, INT pin.
+ */
+
+/* Stand-in for the SS and INT pin types: the template's pin operations become no-ops */
+struct UhsModelPin {
+        static void Set() {
+        };
+
+        static void Clear() {
+        };
+
+        static void SetDirRead() {
+        };
+
+        static void SetDirWrite() {
+        };
+
+        static uint8_t IsSet() {
+                return 1;
+        };
+};
+
+/* A device attached to the modelled bus */
+class UhsModelDevice {
+public:
+        virtual ~UhsModelDevice() {
+        };
+
+        virtual bool lowSpeed() const {
+                return false;
+        };
+
+        // Drops off the bus while VBUS is switched off
+        virtual bool busPowered() const {
+                return false;
+        };
+
+        virtual uint8_t maxPacket0() const {
+                return 64;
+        };
+
+        // Control request other than SET_ADDRESS, which the model handles. For
+        // device-to-host requests fill reply with at most *len bytes and update
+        // *len. Return hrSUCCESS or hrSTALL.
+        virtual uint8_t control(const uint8_t *setup, uint8_t *reply, uint16_t *len) = 0;
+
+        // IN token on endpoint ep (> 0): fill buf with at most *len bytes, or return hrNAK
+        virtual uint8_t in(uint8_t ep, uint8_t *buf, uint8_t *len) = 0;
+
+        // OUT data on endpoint ep (> 0). Return hrSUCCESS, hrNAK or hrSTALL.
+        virtual uint8_t out(uint8_t ep, const uint8_t *buf, uint8_t len) = 0;
+
+        virtual void busReset() {
+        };
+
+        // For hubs: the device on a downstream port (1-based), if that port is enabled
+        virtual UhsModelDevice *downstream(uint8_t port __attribute__((unused))) {
+                return nullptr;
+        };
+
+        // Bus address, assigned by SET_ADDRESS and kept by the model
+        uint8_t address = 0;
+};
+
+/*
+ * Scriptable device: answers the standard descriptor and configuration
+ * requests from the descriptors given, accepts class requests, hands every
+ * OUT report to onOut, and returns queued IN reports once their latency has
+ * elapsed (NAKing until then).
+ */
+class UhsScriptedDevice : public UhsModelDevice {
+public:
+        static const uint8_t maxQueued = 8;
+
+        UhsScriptedDevice(const uint8_t *devDescr, const uint8_t *confDescr, uint16_t confLen) :
+        devDescr(devDescr), confDescr(confDescr), confLen(confLen) {
+        };
+
+        // Called for each OUT report; typically queues the response with queueReport()
+        void (*onOut)(UhsScriptedDevice &dev, uint8_t ep, const uint8_t *buf, uint8_t len) = nullptr;
+
+        // Queue an IN report on ep, readable latencyUs from now. Returns false if the queue is full.
+        bool queueReport(uint8_t ep, const uint8_t *buf, uint8_t len, uint32_t latencyUs = 0);
+
+        uint8_t getConfiguration() const {
+                return bConfiguration;
+        };
+
+        uint8_t control(const uint8_t *setup, uint8_t *reply, uint16_t *len) override;
+        uint8_t in(uint8_t ep, uint8_t *buf, uint8_t *len) override;
+        uint8_t out(uint8_t ep, const uint8_t *buf, uint8_t len) override;
+        void busReset() override;
+
+private:
+        struct Report {
+                uint64_t readyNs;
+                uint8_t ep;
+                uint8_t len;
+                uint8_t data[64];
+        };
+
+        const uint8_t *devDescr;
+        const uint8_t *confDescr;
+        uint16_t confLen;
+        uint8_t bConfiguration = 0;
+
+        Report queue[maxQueued];
+        uint8_t qCount = 0;
+};
+
+/*
+ * Full-speed hub with per-port power switching. Answers the hub class
+ * requests USBHub makes, reports port changes on its interrupt endpoint, and
+ * lets the model route to a downstream device once its port has been reset.
+ * Port resets complete at once.
+ */
+class UhsModelHub : public UhsScriptedDevice {
+public:
+        static const uint8_t numPorts = 4;
+
+        UhsModelHub();
+
+        // Connect or disconnect a device on a port (1-based)
+        void plug(uint8_t port, UhsModelDevice *dev);
+        void unplug(uint8_t port);
+
+        uint8_t control(const uint8_t *setup, uint8_t *reply, uint16_t *len) override;
+        uint8_t in(uint8_t ep, uint8_t *buf, uint8_t *len) override;
+        uint8_t out(uint8_t ep, const uint8_t *buf, uint8_t len) override;
+        void busReset() override;
+        UhsModelDevice *downstream(uint8_t port) override;
+
+private:
+        struct Port {
+                UhsModelDevice *device;
+                uint16_t status;
+                uint16_t change;
+        };
+
+        void setPortFeature(Port &p, uint8_t feature);
+        void clearPortFeature(Port &p, uint8_t feature);
+
+        Port ports[numPorts] = {};
+};
+
+class UhsModel {
+public:
+        struct Timing {
+                uint32_t spiSetupNs = 1500;     // per register access: CS, transaction setup, call overhead
+                uint32_t spiByteNs = 1000;      // per SPI byte at 8 MHz
+                uint32_t tokenNs = 3000;        // token, turnaround and handshake on a full-speed bus
+                uint32_t byteNs = 700;          // per data byte at 12 Mb/s, including bit stuffing
+                uint32_t timeoutNs = 20000;     // nobody answered
+                uint32_t busResetNs = 10000000; // BUSRST held by the chip
+        };
+
+        struct Stats {
+                uint32_t spiAccesses;
+                uint32_t spiBytes;
+                uint64_t spiNs;         // time the CPU spent talking to the chip
+                uint32_t transfers;     // HXFR launches
+                uint32_t naks;
+                uint64_t busNs;         // time the bus was busy with our transfers
+        };
+
+        Timing timing;
+        Stats stats = {};
+
+        static UhsModel& instance() {
+                static UhsModel model;
+                return model;
+        };
+
+        // Simulated clock
+        uint64_t nanos() const {
+                return now;
+        };
+
+        uint32_t micros() const {
+                return (uint32_t)(now / 1000);
+        };
+
+        uint32_t millis() const {
+                return (uint32_t)(now / 1000000);
+        };
+
+        void advance(uint64_t ns) {
+                now += ns;
+        };
+
+        void attach(UhsModelDevice *dev);
+        void detach();
+
+        void resetStats() {
+                stats = Stats();
+        };
+
+        // Register interface used by MAX3421e<>
+        void regWr(uint8_t reg, uint8_t data);
+        uint8_t regRd(uint8_t reg);
+        void bytesWr(uint8_t reg, uint8_t nbytes, const uint8_t *data);
+        void bytesRd(uint8_t reg, uint8_t nbytes, uint8_t *data);
+
+private:
+        UhsModel() {
+                chipReset();
+        };
+
+        void chipReset();
+        void spiCost(uint8_t nbytes);
+        void update();
+        void launch(uint8_t hxfr);
+        uint8_t busState() const;
+        bool deviceOnBus() const;
+        UhsModelDevice *route(UhsModelDevice *dev, uint8_t addr);
+
+        uint64_t now = 0;
+
+        UhsModelDevice *device = nullptr;
+        bool vbusOff = false;
+
+        // Registers
+        uint8_t hirq = 0;
+        uint8_t hien = 0;
+        uint8_t mode = 0;
+        uint8_t hctl = 0;
+        uint8_t hrsl = 0;
+        uint8_t peraddr = 0;
+        uint8_t usbctl = 0;
+        uint8_t usbirq = 0;
+        uint8_t pinctl = 0;
+        uint8_t cpuctl = 0;
+        uint8_t iopins1 = 0;
+        uint8_t iopins2 = 0;
+
+        bool xferBusy = false;
+        bool xferRcv = false;
+        uint8_t xferResult = 0;
+        uint64_t xferDoneNs = 0;
+        uint64_t busResetDoneNs = 0;
+        uint64_t frameNs = 0;
+
+        uint8_t sudFifo[8] = {};
+        uint8_t sudPos = 0;
+        uint8_t sndFifo[64] = {};
+        uint8_t sndPos = 0;
+        uint8_t sndbc = 0;
+        uint8_t rcvFifo[64] = {};
+        uint8_t rcvPos = 0;
+        uint8_t rcvbc = 0;
+        bool rcvTog = false;
+        bool sndTog = false;
+
+        // Device-side state
+        UhsModelDevice *target = nullptr;       // addressed by the last SETUP
+        uint8_t pendingAddress = 0;
+        bool addressPending = false;
+        bool ctrlStall = false;
+        uint8_t ctrlBuf[512] = {};
+        uint16_t ctrlLen = 0;
+        uint16_t ctrlPos = 0;
+};
+
+#endif // UHS_HOST_MODEL
+
+#endif // __MAX3421E_MODEL_H__
@@ -49,6 +49,27 @@ e-mail   :  support@circuitsathome.com
 #define USB_HOST_SERIAL Serial
 #endif
 
+/* Set this to 1 to record a binary event trace (see usbtrace.h) in a RAM ring.
+ * Recording is cheap enough to leave on while chasing timing-dependent faults,
+ * where the text output of ENABLE_UHS_DEBUGGING would hide the problem.
+ */
+#ifndef ENABLE_UHS_EVENT_TRACE
+#define ENABLE_UHS_EVENT_TRACE 0
+#endif
+
+/* Number of 8-byte records kept in the trace ring. Must be a power of two. */
+#ifndef UHS_EVENT_TRACE_DEPTH
+#define UHS_EVENT_TRACE_DEPTH 256
+#endif
+
+/* Set this to 1 to run against the software MAX3421E register model
+ * (max3421e_model.h) instead of the shield, e.g. in a Linux process built from
+ * tools/uhs_host. Never set it for the board.
+ */
+#ifndef UHS_HOST_MODEL
+#define UHS_HOST_MODEL 0
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Manual board activation
 ////////////////////////////////////////////////////////////////////////////////
@@ -62,6 +83,19 @@ e-mail   :  support@circuitsathome.com
 /* Set this to a one to use the xmem2 lock. This is needed for multitasking and threading */
 #define USE_XMEM_SPI_LOCK 0
 
+////////////////////////////////////////////////////////////////////////////////
+// HID report parsing
+////////////////////////////////////////////////////////////////////////////////
+
+/* Set this to 1 to build the generic HID report descriptor parser, the usage
+ * string tables and the per-report-ID parser registry in HIDComposite.
+ * Leave it at 0 when the only HID driver registered parses its own fixed-size
+ * reports (e.g. MiniDSP), so none of that ends up in flash or RAM.
+ */
+#ifndef ENABLE_HID_REPORT_PARSING
+#define ENABLE_HID_REPORT_PARSING 0
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Wii IR camera
 ////////////////////////////////////////////////////////////////////////////////
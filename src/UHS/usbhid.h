@@ -18,7 +18,9 @@ e-mail   :  support@circuitsathome.com
 #define __USBHID_H__
 
 #include "Usb.h"
+#if ENABLE_HID_REPORT_PARSING
 #include "hidusagestr.h"
+#endif
 
 #define MAX_REPORT_PARSERS                      2
 #define HID_MAX_HID_CLASS_DESCRIPTORS           5
@@ -37,7 +37,10 @@ e-mail   :  support@circuitsathome.com
 /* SPI initialization */
 template< typename SPI_CLK, typename SPI_MOSI, typename SPI_MISO, typename SPI_SS > class SPi {
 public:
-#if USING_SPI4TEENSY3
+#if UHS_HOST_MODEL
+        static void init() {
+        }
+#elif USING_SPI4TEENSY3
         static void init() {
                 // spi4teensy3 inits everything for us, except /SS
                 // CLK, MOSI and MISO are hard coded for now.
@@ -97,7 +100,9 @@ public:
         // The remaining pins are definedin variant.h for the Feather nrf52840 Express
         #define PIN_SPI_SS (1)
 #endif
-#if defined(PIN_SPI_SCK) && defined(PIN_SPI_MOSI) && defined(PIN_SPI_MISO) && defined(PIN_SPI_SS)
+#if UHS_HOST_MODEL
+typedef SPi< UhsModelPin, UhsModelPin, UhsModelPin, UhsModelPin > spi;
+#elif defined(PIN_SPI_SCK) && defined(PIN_SPI_MOSI) && defined(PIN_SPI_MISO) && defined(PIN_SPI_SS)
 // Use pin defines: https://github.com/arduino/Arduino/pull/4814
 // Based on: https://www.mikeash.com/pyblog/friday-qa-2015-03-20-preprocessor-abuse-and-optional-parentheses.html
 #define NOTHING_EXTRACT
@@ -159,6 +164,11 @@ public:
                 regWr(rPINCTL, (bmFDUPSPI | bmINTLEVEL | state));
         }
 
+        // Stop the oscillator, for standby. SPI access still works; Init() resets the chip and restarts it.
+        void powerDown() {
+                regWr(rUSBCTL, bmPWRDOWN);
+        }
+
         uint8_t getVbusState(void) {
                 return vbusState;
         };
@@ -186,6 +196,9 @@ MAX3421e< SPI_SS, INTR >::MAX3421e() {
 /* write single byte into MAX3421 register */
 template< typename SPI_SS, typename INTR >
 void MAX3421e< SPI_SS, INTR >::regWr(uint8_t reg, uint8_t data) {
+#if UHS_HOST_MODEL
+        UhsModel::instance().regWr(reg, data);
+#else
         XMEM_ACQUIRE_SPI();
 #if defined(SPI_HAS_TRANSACTION)
         USB_SPI.beginTransaction(SPISettings(26000000, MSBFIRST, SPI_MODE0)); // The MAX3421E can handle up to 26MHz, use MSB First and SPI mode 0
@@ -223,12 +236,17 @@ void MAX3421e< SPI_SS, INTR >::regWr(uint8_t reg, uint8_t data) {
 #endif
         XMEM_RELEASE_SPI();
         return;
+#endif
 };
 /* multiple-byte write                            */
 
 /* returns a pointer to memory position after last written */
 template< typename SPI_SS, typename INTR >
 uint8_t* MAX3421e< SPI_SS, INTR >::bytesWr(uint8_t reg, uint8_t nbytes, uint8_t* data_p) {
+#if UHS_HOST_MODEL
+        UhsModel::instance().bytesWr(reg, nbytes, data_p);
+        return ( data_p + nbytes);
+#else
         XMEM_ACQUIRE_SPI();
 #if defined(SPI_HAS_TRANSACTION)
         USB_SPI.beginTransaction(SPISettings(26000000, MSBFIRST, SPI_MODE0)); // The MAX3421E can handle up to 26MHz, use MSB First and SPI mode 0
@@ -271,6 +289,7 @@ uint8_t* MAX3421e< SPI_SS, INTR >::bytesWr(uint8_t reg, uint8_t nbytes, uint8_t*
 #endif
         XMEM_RELEASE_SPI();
         return ( data_p);
+#endif
 }
 /* GPIO write                                           */
 /*GPIO byte is split between 2 registers, so two writes are needed to write one byte */
@@ -287,6 +306,9 @@ void MAX3421e< SPI_SS, INTR >::gpioWr(uint8_t data) {
 /* single host register read    */
 template< typename SPI_SS, typename INTR >
 uint8_t MAX3421e< SPI_SS, INTR >::regRd(uint8_t reg) {
+#if UHS_HOST_MODEL
+        return UhsModel::instance().regRd(reg);
+#else
         XMEM_ACQUIRE_SPI();
 #if defined(SPI_HAS_TRANSACTION)
         USB_SPI.beginTransaction(SPISettings(26000000, MSBFIRST, SPI_MODE0)); // The MAX3421E can handle up to 26MHz, use MSB First and SPI mode 0
@@ -320,12 +342,17 @@ uint8_t MAX3421e< SPI_SS, INTR >::regRd(uint8_t reg) {
 #endif
         XMEM_RELEASE_SPI();
         return (rv);
+#endif
 }
 /* multiple-byte register read  */
 
 /* returns a pointer to a memory position after last read   */
 template< typename SPI_SS, typename INTR >
 uint8_t* MAX3421e< SPI_SS, INTR >::bytesRd(uint8_t reg, uint8_t nbytes, uint8_t* data_p) {
+#if UHS_HOST_MODEL
+        UhsModel::instance().bytesRd(reg, nbytes, data_p);
+        return ( data_p + nbytes);
+#else
         XMEM_ACQUIRE_SPI();
 #if defined(SPI_HAS_TRANSACTION)
         USB_SPI.beginTransaction(SPISettings(26000000, MSBFIRST, SPI_MODE0)); // The MAX3421E can handle up to 26MHz, use MSB First and SPI mode 0
@@ -384,6 +411,7 @@ uint8_t* MAX3421e< SPI_SS, INTR >::bytesRd(uint8_t reg, uint8_t nbytes, uint8_t*
 #endif
         XMEM_RELEASE_SPI();
         return ( data_p);
+#endif
 }
 /* GPIO read. See gpioWr for explanation */
 
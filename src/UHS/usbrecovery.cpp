@@ -0,0 +1,153 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+
+#include "usbrecovery.h"
+
+// Used until enough successes have been seen. The MiniDSP normally enumerates in
+// about 6 s from power on, and in about 1 s after a reset, so Watch and the three
+// resets together fit the old fixed 10 s startup allowance.
+const uint32_t USBRecovery::defaultTimeout[nSteps] = {7000, 1000, 1000, 1000, 10000};
+
+// Bounds on the learned timeouts. Watch can only shorten, since the resets share
+// what it leaves of ladderBudget. A reset can learn anything from a little over
+// the time to enumerate (plus vbusOffTime for the toggle) to 2.5 s.
+const uint32_t USBRecovery::minTimeout[nSteps] = {4000, 300, 300, 550, 4000};
+const uint32_t USBRecovery::maxTimeout[nSteps] = {7000, 2500, 2500, 2500, 10000};
+
+static const char * const stepNames[USBRecovery::nSteps] = {"Watch", "BusReset", "ChipReset", "VbusToggle", "PowerCycle"};
+
+void USBRecovery::start() {
+        uint32_t now = (uint32_t)millis();
+
+        // Power is back after a cycle: keep timing the same attempt, against the PowerCycle step
+        if(bActive && step == PowerCycle) {
+                stepTime = now;
+                return;
+        }
+
+        bActive = true;
+        startTime = now;
+        enterStep(Watch, now);
+}
+
+void USBRecovery::connected() {
+        if(!bActive)
+                return;
+        bActive = false;
+
+        if(bVbusOff) {
+                pUsb->vbusPower(vbus_on);
+                bVbusOff = false;
+        }
+
+        uint32_t now = (uint32_t)millis();
+        StepStats &s = stats[step];
+        s.successes++;
+        s.totalRecover += now - startTime;
+
+        // Smoothed mean and mean deviation, scaled by 8 and 4 as in Jacobson's RTT estimator
+        int32_t m = (int32_t)(now - stepTime);
+        if(s.successes == 1) {
+                s.avg = m << 3;
+                s.dev = m << 1;
+        } else {
+                int32_t err = m - (s.avg >> 3);
+                s.avg += err;
+                if(err < 0)
+                        err = -err;
+                s.dev += err - (s.dev >> 2);
+        }
+}
+
+uint32_t USBRecovery::getTimeout(step_t s) const {
+        if(stats[s].successes < minSamples)
+                return defaultTimeout[s];
+
+        uint32_t learned = (uint32_t)((stats[s].avg >> 3) + stats[s].dev);
+        if(learned < minTimeout[s])
+                return minTimeout[s];
+        if(learned > maxTimeout[s])
+                return maxTimeout[s];
+        return learned;
+}
+
+USBRecovery::step_t USBRecovery::Task() {
+        if(!bActive)
+                return step;
+
+        uint32_t now = (uint32_t)millis();
+
+        if(bVbusOff && (now - stepTime) >= vbusOffTime) {
+                pUsb->vbusPower(vbus_on);
+                bVbusOff = false;
+                pUsb->ResetBus();
+        }
+
+        bool overBudget = step != PowerCycle && (now - startTime) >= ladderBudget;
+        if(!overBudget && (now - stepTime) < getTimeout(step))
+                return step;
+
+        // Timed out: escalate, or repeat the power cycle if that's all that's left
+        step_t next = (step == PowerCycle || overBudget) ? PowerCycle : (step_t)(step + 1);
+        uint8_t vbus = pUsb->getVbusState();
+        if(next == BusReset && vbus != FSHOST && vbus != LSHOST)
+                next = ChipReset;
+
+        enterStep(next, now);
+        return step;
+}
+
+void USBRecovery::enterStep(step_t s, uint32_t now) {
+        step = s;
+        stepTime = now;
+        stats[s].attempts++;
+
+        USBEVENT(UHS_EV_RECOVERY, s, (now - startTime) / 10);
+
+        switch(s) {
+                case BusReset:
+                        pUsb->ResetBus();
+                        break;
+                case ChipReset:
+                        pUsb->Init();
+                        pUsb->busprobe(true);
+                        pUsb->ResetBus();
+                        break;
+                case VbusToggle:
+                        pUsb->vbusPower(vbus_off);
+                        bVbusOff = true;
+                        break;
+                case PowerCycle:
+                        if(pFuncPowerCycle != nullptr)
+                                pFuncPowerCycle();
+                        break;
+                default:
+                        break;
+        }
+}
+
+void USBRecovery::printStats(Print &out) const {
+        char buf[80];
+        for(uint8_t i = 0; i < nSteps; i++) {
+                const StepStats &s = stats[i];
+                snprintf(buf, sizeof (buf), "%-10s %3u/%-3u ok, recover %5lu ms, timeout %5lu ms",
+                        stepNames[i], s.successes, s.attempts,
+                        s.successes ? (unsigned long)(s.totalRecover / s.successes) : 0UL,
+                        (unsigned long)getTimeout((step_t)i));
+                out.println(buf);
+        }
+}
@@ -0,0 +1,134 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+
+#if !defined(__USBRECOVERY_H__)
+#define __USBRECOVERY_H__
+
+#include "Usb.h"
+
+/**
+ * Graded recovery for a device that fails to enumerate.
+ *
+ * After start() the ladder waits for the device to connect. Each time a step
+ * times out it escalates to the next, cheapest first:
+ *   Watch       - nothing, just wait (e.g. for the device to boot)
+ *   BusReset    - release the device and let USB::Task settle and reset the bus
+ *   ChipReset   - USB::Init() plus a forced busprobe() to reset the MAX3421E
+ *   VbusToggle  - switch VBUS off and on via the GPX pin (harmless on boards
+ *                 that don't switch VBUS from GPX)
+ *   PowerCycle  - hand over to the application's power-cycle callback
+ * BusReset is skipped when nothing is attached, since there is no bus to reset.
+ * An attempt ends only with connected(): the application keeps waiting for the
+ * device, through any power cycles, until it arrives.
+ *
+ * Step timeouts are learned from how long each step has taken to succeed
+ * (mean plus four mean deviations, as for a TCP retransmit timer), clamped to
+ * [minTimeout, maxTimeout]. defaultTimeout applies until a step has minSamples
+ * successes. A reset that reliably works quickly thus escalates sooner when it
+ * doesn't, and one that needs longer than the default gets it. However the steps
+ * are timed, the ladder reaches PowerCycle no more than ladderBudget after start().
+ */
+class USBRecovery {
+public:
+        enum step_t : uint8_t {
+                Watch = 0,
+                BusReset,
+                ChipReset,
+                VbusToggle,
+                PowerCycle,
+                nSteps
+        };
+
+        struct StepStats {
+                uint16_t attempts;      // times the step was entered
+                uint16_t successes;     // times the device connected during the step
+                uint32_t totalRecover;  // ms from start() to connection, summed over successes
+                int32_t avg;            // smoothed ms from step entry to connection (x8)
+                int32_t dev;            // smoothed mean deviation of the above (x4)
+        };
+
+        USBRecovery(USB *p) : pUsb(p) {
+        };
+
+        /**
+         * Used to call your own function when the ladder reaches PowerCycle.
+         * The function should cut power to the device and later call start() again.
+         * @param funcPowerCycle Function to call.
+         */
+        void attachPowerCycle(void (*funcPowerCycle)(void)) {
+                pFuncPowerCycle = funcPowerCycle;
+        };
+
+        /**
+         * Begin waiting for the device. If the previous attempt ended in a
+         * power cycle, this continues that attempt on the PowerCycle step.
+         */
+        void start();
+
+        /**
+         * Call when the device has connected. Records the result against the current step.
+         */
+        void connected();
+
+        /**
+         * Call from the polling loop. Escalates when the current step times out.
+         * @return The current step.
+         */
+        step_t Task();
+
+        bool active() const {
+                return bActive;
+        };
+
+        step_t getStep() const {
+                return step;
+        };
+
+        uint32_t getTimeout(step_t s) const;
+
+        const StepStats& getStats(step_t s) const {
+                return stats[s];
+        };
+
+        /**
+         * Print per-step success rates, mean time to recover and current timeouts.
+         */
+        void printStats(Print &out) const;
+
+private:
+        static const uint32_t defaultTimeout[nSteps];
+        static const uint32_t minTimeout[nSteps];
+        static const uint32_t maxTimeout[nSteps];
+        static const uint8_t minSamples = 4;    // successes needed before a learned timeout is used
+        static const uint32_t vbusOffTime = 250; // ms
+        static const uint32_t ladderBudget = 10000; // ms, from start() to PowerCycle
+
+        void enterStep(step_t s, uint32_t now);
+
+        USB *pUsb;
+        void (*pFuncPowerCycle)(void) = nullptr;
+
+        step_t step = Watch;
+        bool bActive = false;
+        bool bVbusOff = false;
+        uint32_t startTime = 0;         // start() of the current attempt
+        uint32_t stepTime = 0;          // entry into the current step
+
+        StepStats stats[nSteps] = {};
+};
+
+#endif // __USBRECOVERY_H__
@@ -0,0 +1,91 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+/* Binary USB event trace */
+
+#include "Usb.h"
+
+#if ENABLE_UHS_EVENT_TRACE
+
+static_assert((UHS_EVENT_TRACE_DEPTH & (UHS_EVENT_TRACE_DEPTH - 1)) == 0, "UHS_EVENT_TRACE_DEPTH must be a power of two");
+static_assert(sizeof (UsbTraceEvent) == 8, "UsbTraceEvent must pack to 8 bytes");
+
+uint32_t UsbTraceMask = ~(1UL << UHS_EV_DISPATCH);
+
+UsbTraceEvent UsbTraceRing[UHS_EVENT_TRACE_DEPTH];
+uint16_t UsbTraceHead = 0;
+uint16_t UsbTraceCount = 0;
+uint16_t UsbTraceDropped = 0;
+bool UsbTraceFrozen = false;
+
+void UsbTraceFreeze(bool freeze) {
+        UsbTraceFrozen = freeze;
+}
+
+void UsbTraceClear() {
+        UsbTraceHead = 0;
+        UsbTraceCount = 0;
+        UsbTraceDropped = 0;
+}
+
+static void UsbTraceWrite(Print &out, const uint8_t *bytes, uint8_t len, bool hex) {
+        if(!hex) {
+                out.write(bytes, len);
+                return;
+        }
+        for(uint8_t i = 0; i < len; i++) {
+                if(bytes[i] < 0x10)
+                        out.print('0');
+                out.print(bytes[i], HEX);
+        }
+}
+
+uint16_t UsbTraceDump(Print &out, bool hex) {
+        // Hold recording off while we walk the ring
+        bool wasFrozen = UsbTraceFrozen;
+        UsbTraceFrozen = true;
+
+        uint16_t count = UsbTraceCount;
+        uint16_t index = (UsbTraceHead - count) & (UHS_EVENT_TRACE_DEPTH - 1);
+        uint8_t header[8] = {'U', 'H', 'T', '1',
+                (uint8_t)count, (uint8_t)(count >> 8),
+                (uint8_t)UsbTraceDropped, (uint8_t)(UsbTraceDropped >> 8)};
+
+        if(hex)
+                out.println(F("UHT1 BEGIN"));
+        UsbTraceWrite(out, header, sizeof (header), hex);
+        if(hex)
+                out.println();
+
+        for(uint16_t i = 0; i < count; i++) {
+                const UsbTraceEvent *e = &UsbTraceRing[index];
+                uint8_t rec[8] = {
+                        (uint8_t)e->time, (uint8_t)(e->time >> 8), (uint8_t)(e->time >> 16), (uint8_t)(e->time >> 24),
+                        e->code, e->arg1, (uint8_t)e->arg2, (uint8_t)(e->arg2 >> 8)};
+                UsbTraceWrite(out, rec, sizeof (rec), hex);
+                if(hex)
+                        out.println();
+                index = (index + 1) & (UHS_EVENT_TRACE_DEPTH - 1);
+        }
+
+        if(hex)
+                out.println(F("UHT1 END"));
+
+        UsbTraceFrozen = wasFrozen;
+        return count;
+}
+
+#endif
@@ -0,0 +1,103 @@
+/* Copyright (C) 2011 Circuits At Home, LTD. All rights reserved.
+
+This software may be distributed and modified under the terms of the GNU
+General Public License version 2 (GPL2) as published by the Free Software
+Foundation and appearing in the file GPL2.TXT included in the packaging of
+this file. Please note that GPL2 Section 2[b] requires that all works based
+on this software must also be made publicly available under the terms of
+the GPL2 ("Copyleft").
+
+Contact information
+-------------------
+
+Circuits At Home, LTD
+Web      :  http://www.circuitsathome.com
+e-mail   :  support@circuitsathome.com
+ */
+#if !defined(_usb_h_) || defined(__USBTRACE_H__)
+#error "Never include usbtrace.h directly; include Usb.h instead"
+#else
+#define __USBTRACE_H__
+
+/*
+ * Binary event trace.
+ *
+ * Unlike USBTRACE, which prints text and disturbs the timing it is meant to
+ * observe, USBEVENT() stores an 8-byte record (micros() timestamp, event code,
+ * two arguments) in a RAM ring. The ring is dumped after the fact with
+ * UsbTraceDump(), to Serial or to any other Print such as a LittleFS file,
+ * and decoded on the host with tools/usbtrace_decode.py.
+ *
+ * Dump format (all little-endian):
+ *   "UHT1" magic, uint16_t record count, uint16_t records dropped, then
+ *   count records of { uint32_t time_us; uint8_t code; uint8_t arg1; uint16_t arg2; }
+ * In hex mode the same bytes are printed as text, one record per line, between
+ * "UHT1 BEGIN" and "UHT1 END" so they can be captured from a serial console.
+ *
+ * Keep the codes below in step with EVENTS in tools/usbtrace_decode.py.
+ */
+
+enum UsbTraceCode : uint8_t {
+        UHS_EV_NONE = 0,
+        UHS_EV_VBUS = 1, // arg1 = new vbus state, arg2 = task state
+        UHS_EV_TASK_STATE = 2, // arg1 = new task state, arg2 = previous task state
+        UHS_EV_CTRL_REQ = 3, // arg1 = addr << 4 | ep, arg2 = bmReqType << 8 | bRequest
+        UHS_EV_CTRL_VALUE = 4, // arg1 = wValHi (descriptor type for GET_DESCRIPTOR), arg2 = total length
+        UHS_EV_SETADDR_FAIL = 5, // arg1 = rcode, arg2 = addr << 8 | ep
+        UHS_EV_IN_XFER = 6, // arg1 = ep, arg2 = bytes requested
+        UHS_EV_IN_DONE = 7, // arg1 = rcode, arg2 = bytes received
+        UHS_EV_DISPATCH = 8, // arg1 = token | ep, arg2 = nak limit
+        UHS_EV_CONF_SIZE = 9, // arg1 = conf, arg2 = wTotalLength
+        UHS_EV_HID_SETIDLE = 10, // arg1 = interface, arg2 = rcode
+        UHS_EV_HID_POLL = 11, // arg1 = interface, arg2 = rcode << 8 | bytes read
+        UHS_EV_RECOVERY = 12, // arg1 = recovery step entered, arg2 = 10 ms units since the attempt started
+        UHS_EV_USER = 16 // first code free for the application
+};
+
+#if ENABLE_UHS_EVENT_TRACE
+
+struct UsbTraceEvent {
+        uint32_t time;
+        uint8_t code;
+        uint8_t arg1;
+        uint16_t arg2;
+};
+
+// Events whose code bit is clear are not recorded. UHS_EV_DISPATCH is off by
+// default: it fires for every packet, including each NAKed interrupt poll,
+// and would flush everything else out of the ring within milliseconds.
+extern uint32_t UsbTraceMask;
+
+extern UsbTraceEvent UsbTraceRing[UHS_EVENT_TRACE_DEPTH];
+extern uint16_t UsbTraceHead;
+extern uint16_t UsbTraceCount;
+extern uint16_t UsbTraceDropped;
+extern bool UsbTraceFrozen;
+
+static inline void UsbTraceRecord(uint8_t code, uint8_t arg1, uint16_t arg2) {
+        if(UsbTraceFrozen || !(UsbTraceMask & (1UL << (code & 0x1f))))
+                return;
+        UsbTraceEvent *e = &UsbTraceRing[UsbTraceHead];
+        e->time = (uint32_t)micros();
+        e->code = code;
+        e->arg1 = arg1;
+        e->arg2 = arg2;
+        UsbTraceHead = (UsbTraceHead + 1) & (UHS_EVENT_TRACE_DEPTH - 1);
+        if(UsbTraceCount < UHS_EVENT_TRACE_DEPTH)
+                UsbTraceCount++;
+        else
+                UsbTraceDropped++;
+}
+
+// Stop recording, e.g. at the moment a failure is detected, so the dump shows what led up to it
+void UsbTraceFreeze(bool freeze = true);
+void UsbTraceClear();
+// Writes the ring, oldest record first. Returns the number of records written.
+uint16_t UsbTraceDump(Print &out, bool hex = false);
+
+#define USBEVENT(code, arg1, arg2) UsbTraceRecord((code), (uint8_t)(arg1), (uint16_t)(arg2))
+#else
+#define USBEVENT(code, arg1, arg2) ((void)0)
+#endif
+
+#endif // __USBTRACE_H__
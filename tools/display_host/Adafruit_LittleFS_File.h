@@ -0,0 +1,2 @@
+// Options.h includes the filesystem headers; the host build only uses the defaults it declares.
+#pragma once
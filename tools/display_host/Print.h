@@ -0,0 +1,3 @@
+// U8x8lib.h includes Print.h; Print itself comes from the Arduino shim in tools/uhs_host.
+#pragma once
+#include <Arduino.h>
@@ -0,0 +1,3 @@
+// U8x8lib.h includes Wire.h. The host display has its own byte callback, so nothing here is used.
+#pragma once
+#include <Arduino.h>
@@ -0,0 +1,320 @@
+// Runs AmpDisplay unmodified in a Linux process, on the real U8g2 library with an SH1107 64x128
+// in memory (rotated U8G2_R1 as in the sketch). Renders each screen, writes the frames as PBM
+// images or checks them against saved ones, and reports the cost of drawing and sending each
+// kind of update.
+//
+// Build from the repository root, with U8G2 set to the src directory of the U8g2 Arduino library:
+//   gcc -c -O2 -I$U8G2/clib $U8G2/clib/*.c
+//   g++ -std=gnu++11 -O2 -DARDUINO=100 -DUHS_HOST_MODEL=1 -Itools/display_host -Itools/uhs_host
+//       -Isrc/UHS -I. -I$U8G2 tools/display_host/display_host.cpp AmpDisplay.cpp $U8G2/U8g2lib.cpp
+//       tools/uhs_host/arduino_host.cpp src/UHS/max3421e_model.cpp *.o -o display_host
+//
+//   usage: display_host [--write DIR | --check DIR] [updates [i2c_khz]]
+//     --write DIR  save every screen as DIR/<screen>.pbm
+//     --check DIR  compare every screen with DIR/<screen>.pbm; differing frames are saved as
+//                  DIR/<screen>.actual.pbm and the exit status is 1
+//     updates      updates of each kind to time (default 1000)
+//     i2c_khz      I2C clock for the bus time estimate (default 400, U8g2's clock for the SH1107)
+//
+// Time as seen by AmpDisplay (dimming, frame interval) is the UHS model's clock, which only moves
+// when advanced here, so frames are the same on every run. Draw times are host CPU time: use them
+// to compare changes, not as nRF52 figures. Bus figures count the bytes U8g2 actually sends.
+
+#include <stdio.h>
+#include <chrono>
+#include "AmpDisplay.h"
+
+// I2C traffic, counted by the byte callback
+struct BusStats {
+        uint32_t transfers;
+        uint32_t bytes;
+};
+
+static BusStats bus;
+
+static uint8_t hostByte(u8x8_t *, uint8_t msg, uint8_t arg_int, void *) {
+        switch(msg) {
+                case U8X8_MSG_BYTE_START_TRANSFER:
+                        bus.transfers++;
+                        break;
+                case U8X8_MSG_BYTE_SEND:
+                        bus.bytes += arg_int;
+                        break;
+        }
+        return 1;
+}
+
+static uint8_t hostGpio(u8x8_t *, uint8_t, uint8_t, void *) {
+        return 1;
+}
+
+// The sketch's display, with the I2C bus replaced by the counting callback
+class HostDisplay : public U8G2 {
+public:
+        HostDisplay() : U8G2() {
+                u8g2_Setup_sh1107_i2c_64x128_f(&u8g2, U8G2_R1, hostByte, hostGpio);
+        }
+};
+
+static HostDisplay display;
+static AmpDisplay ampDisp(&display);
+
+static void advanceMs(uint32_t ms) {
+        UhsModel::instance().advance((uint64_t)ms * 1000000);
+}
+
+// ---- Frames ----
+
+static const uint8_t screenWidth = 128;
+static const uint8_t screenHeight = 64;
+static const uint16_t frameBytes = screenWidth / 8 * screenHeight;
+
+// The screen as a PBM bitmap (rows MSB first, 1 = lit), read out of the U8G2_R1 buffer:
+// logical (x, y) is bit x % 8 of byte (x / 8) * 64 + 63 - y
+static void captureFrame(uint8_t *pbm) {
+        const uint8_t *buffer = display.getBufferPtr();
+        memset(pbm, 0, frameBytes);
+        for(uint8_t y = 0; y < screenHeight; y++)
+                for(uint8_t x = 0; x < screenWidth; x++)
+                        if(buffer[(x / 8) * 64 + 63 - y] & (1 << (x % 8)))
+                                pbm[y * (screenWidth / 8) + x / 8] |= 0x80 >> (x % 8);
+}
+
+static bool writePBM(const char *path, const uint8_t *pbm) {
+        FILE *f = fopen(path, "wb");
+        if(!f)
+                return false;
+        fprintf(f, "P4\n%u %u\n", screenWidth, screenHeight);
+        bool ok = fwrite(pbm, 1, frameBytes, f) == frameBytes;
+        return fclose(f) == 0 && ok;
+}
+
+static bool readPBM(const char *path, uint8_t *pbm) {
+        FILE *f = fopen(path, "rb");
+        if(!f)
+                return false;
+        unsigned w = 0, h = 0;
+        bool ok = fscanf(f, "P4 %u %u", &w, &h) == 2 && w == screenWidth && h == screenHeight
+                && fgetc(f) != EOF && fread(pbm, 1, frameBytes, f) == frameBytes;
+        fclose(f);
+        return ok;
+}
+
+static uint16_t pixelsDiffering(const uint8_t *a, const uint8_t *b) {
+        uint16_t n = 0;
+        for(uint16_t i = 0; i < frameBytes; i++)
+                n += __builtin_popcount(a[i] ^ b[i]);
+        return n;
+}
+
+// ---- Screens ----
+
+// Each screen is drawn from the same starting point: a fresh frame, analog source, -30 dB, dB mode
+static void startScreen() {
+        ampDisp.drawFrame();
+        ampDisp.volumeMode(true);
+        ampDisp.source(source_t::Analog);
+        ampDisp.mute(false);
+        ampDisp.volume(60);
+}
+
+static void volumeDB() {
+        ampDisp.volume(41);
+}
+
+static void volumePercent() {
+        ampDisp.volumeMode(false);
+        ampDisp.volume(41);
+}
+
+static void muted() {
+        ampDisp.mute(true);
+}
+
+static void presetShown() {
+        ampDisp.preset(2);
+}
+
+static void digitalSource() {
+        ampDisp.source(source_t::Toslink);
+}
+
+static void longPress() {
+        ampDisp.cueLongPress();
+}
+
+static void vuMeter() {
+        ampDisp.displayLRBarGraph(72, 45, messageArea, 88, 60);
+}
+
+static void message() {
+        ampDisp.displayMessage("USB didn't start");
+}
+
+// Dims at the first frame tick after the dim time, then fades down over DIM_FADE_TIME
+static void dimmed() {
+        ampDisp.setAutoDim(true);
+        advanceMs(Options::instance().dimTime * 1000 + FRAME_INTERVAL + 1);
+        do {
+                ampDisp.task();
+                advanceMs(FRAME_INTERVAL);
+        } while(ampDisp.fadeActive());
+        ampDisp.setAutoDim(false);
+}
+
+struct Screen {
+        const char *name;
+        void (*draw)();
+};
+
+static const Screen screens[] = {
+        {"volume_db", volumeDB},
+        {"volume_pct", volumePercent},
+        {"mute", muted},
+        {"preset", presetShown},
+        {"source_digital", digitalSource},
+        {"long_press", longPress},
+        {"vu_meter", vuMeter},
+        {"message", message},
+        {"dimmed", dimmed},
+};
+
+// Returns the number of screens that differ from the saved ones (check), or could not be saved (write)
+static uint8_t goldenFrames(const char *dir, bool write) {
+        uint8_t failed = 0;
+        uint8_t frame[frameBytes], saved[frameBytes];
+        char path[256];
+
+        for(const Screen &screen : screens) {
+                startScreen();
+                screen.draw();
+                ampDisp.flush();
+                captureFrame(frame);
+
+                snprintf(path, sizeof (path), "%s/%s.pbm", dir, screen.name);
+                if(write) {
+                        if(!writePBM(path, frame)) {
+                                printf("%-16s cannot write %s\n", screen.name, path);
+                                failed++;
+                        }
+                        continue;
+                }
+                if(!readPBM(path, saved)) {
+                        printf("%-16s no saved frame %s\n", screen.name, path);
+                        failed++;
+                        continue;
+                }
+                uint16_t differing = pixelsDiffering(frame, saved);
+                if(differing) {
+                        snprintf(path, sizeof (path), "%s/%s.actual.pbm", dir, screen.name);
+                        writePBM(path, frame);
+                        printf("%-16s %u pixels differ, frame saved as %s\n", screen.name, differing, path);
+                        failed++;
+                }
+        }
+        return failed;
+}
+
+// ---- Benchmark ----
+
+static uint32_t random32() {
+        static uint32_t state = 12345;
+        state = state * 1664525 + 1013904223;
+        return state;
+}
+
+// One update of each kind, varied by the step number as it would be in use
+static void stepVolume(uint32_t i) {
+        ampDisp.volume(80 - i % 40);
+}
+
+static void stepMute(uint32_t i) {
+        ampDisp.mute(i & 1);
+}
+
+static void stepSource(uint32_t i) {
+        ampDisp.source(i & 1 ? source_t::Toslink : source_t::Analog);
+}
+
+static void stepVU(uint32_t) {
+        uint8_t left = random32() % 101, right = random32() % 101;
+        ampDisp.displayLRBarGraph(left, right, messageArea, min(100, left + 10), min(100, right + 5));
+}
+
+static void stepMessage(uint32_t i) {
+        ampDisp.displayMessage(i & 1 ? "Input 1: -20.0 dB" : "Input 2: -21.5 dB");
+}
+
+static void stepFrame(uint32_t) {
+        ampDisp.drawFrame();
+}
+
+struct Update {
+        const char *name;
+        void (*step)(uint32_t);
+};
+
+static const Update updates[] = {
+        {"volume step", stepVolume},
+        {"mute toggle", stepMute},
+        {"source change", stepSource},
+        {"VU meter", stepVU},
+        {"message", stepMessage},
+        {"whole frame", stepFrame},
+};
+
+static void benchmark(uint32_t count, uint32_t i2cKHz) {
+        printf("%-14s %9s %9s %9s %11s %11s\n", "update", "draw us", "tiles", "I2C bytes", "transfers", "bus ms");
+        for(const Update &update : updates) {
+                startScreen();
+                ampDisp.flush();
+                uint64_t drawNs = 0;
+                uint32_t tiles = 0;
+                BusStats sent = {0, 0};
+
+                for(uint32_t i = 0; i < count; i++) {
+                        auto t0 = std::chrono::steady_clock::now();
+                        update.step(i);
+                        drawNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+                        bus = {0, 0};
+                        ampDisp.flush();
+                        tiles += ampDisp.lastRefreshTiles();
+                        sent.transfers += bus.transfers;
+                        sent.bytes += bus.bytes;
+                        advanceMs(FRAME_INTERVAL);
+                }
+
+                // Each transfer also sends a start, the address and a stop; 9 bit times per byte
+                double busMs = (sent.bytes + 2.0 * sent.transfers) * 9 / i2cKHz / count;
+                printf("%-14s %9.2f %9.1f %9.1f %11.1f %11.2f\n", update.name, drawNs / 1e3 / count,
+                        (double)tiles / count, (double)sent.bytes / count, (double)sent.transfers / count, busMs);
+        }
+}
+
+int main(int argc, char **argv) {
+        const char *dir = nullptr;
+        bool write = false;
+        int arg = 1;
+        if(argc > arg + 1 && (!strcmp(argv[arg], "--write") || !strcmp(argv[arg], "--check"))) {
+                write = !strcmp(argv[arg], "--write");
+                dir = argv[arg + 1];
+                arg += 2;
+        }
+        uint32_t count = argc > arg ? atol(argv[arg]) : 1000;
+        uint32_t i2cKHz = argc > arg + 1 ? atol(argv[arg + 1]) : 400;
+
+        display.begin();
+        ampDisp.drawFrame();
+        ampDisp.flush();
+
+        if(dir) {
+                uint8_t failed = goldenFrames(dir, write);
+                printf("%u of %u screens %s\n", (unsigned)(sizeof (screens) / sizeof (screens[0])) - failed,
+                        (unsigned)(sizeof (screens) / sizeof (screens[0])), write ? "written" : "match");
+                return failed ? 1 : 0;
+        }
+        if(count && i2cKHz)
+                benchmark(count, i2cKHz);
+        return 0;
+}
@@ -0,0 +1,172 @@
+// Times one VU meter update on a Linux host: the fixed-point path in handleInputLevels() (Meter.h)
+// against the float path of the original sketch (two IIRs with the constant coefficient VUCoeff, and
+// two round() calls and an integer division per bar). Both run over the same input levels, and both
+// paths end at the bar percentages, where the display takes over.
+//
+// Build from the repository root:
+//   g++ -std=gnu++11 -O2 -Itools/uhs_host -Itools/display_host -I. tools/meter_host/meter_bench.cpp -o meter_bench
+//
+//   usage: meter_bench [updates] [passes]
+//     updates      meter updates to time per pass (default 10000000)
+//     passes       passes per path, of which the fastest is reported (default 5)
+//
+// Host time, not nRF52 time: use the ratio to the float path, printed last. Where the CPU has a
+// time stamp counter, its ticks per update are printed too.
+
+#include <stdio.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+#include "util.h"
+#include "Options.h"
+#include "Meter.h"
+
+// The MiniDSP state the bars read
+static volatile uint8_t dspVolume = 40;     // -0.5 dB steps
+static volatile bool dspMuted = false;
+
+static const uint16_t inputCount = 4096;    // Power of 2
+static float inputs[inputCount][2];
+
+static volatile uint32_t sink;
+
+constexpr uint32_t INTERVAL = 50;
+
+/* Float path, as in the original handleInputLevels() and inputVUMeter() */
+
+template <class T> class IIR {     // As in InputSensing.h
+
+        public:
+                IIR(T coeff, T initX) : _x{initX}, _coeff{coeff} {}
+                T next(T u) { return _x += _coeff * (u - _x); };
+
+        private:
+                T _x;
+                T _coeff;
+};
+
+constexpr float VUCoeff = 0.32 * INTERVAL / 50;
+static IIR<float> leftFloat(VUCoeff, -128.0f);
+static IIR<float> rightFloat(VUCoeff, -128.0f);
+
+static float getVolumeDB() { return dspVolume / -2.0; }     // As MiniDSP::getVolumeDB()
+
+__attribute__((noinline)) static void floatUpdate(const float * levels) {
+        float left = leftFloat.next(levels[1]);
+        float right = rightFloat.next(levels[0]);
+
+        int intLeftLevel = round(left + getVolumeDB());
+        int intRightLevel = round(right + getVolumeDB());
+        uint8_t leftPct = !dspMuted ? max(intLeftLevel - MINBARLEVEL, 0) * 100 / -(MINBARLEVEL) : 0;
+        uint8_t rightPct = !dspMuted ? max(intRightLevel - MINBARLEVEL, 0) * 100 / -(MINBARLEVEL) : 0;
+        sink = leftPct | (rightPct << 8);
+}
+
+/* Fixed-point path, as in handleInputLevels() and inputVUMeter() */
+
+constexpr float signalFloorDB = -128.0;
+constexpr level_t signalFloor = signalFloorDB * 256;
+static Meter<VUBallistics, INTERVAL> leftLevel(signalFloor);
+static Meter<VUBallistics, INTERVAL> rightLevel(signalFloor);
+static Meter<PeakHoldBallistics<>, INTERVAL> leftPeak(signalFloor);
+static Meter<PeakHoldBallistics<>, INTERVAL> rightPeak(signalFloor);
+
+constexpr level_t barRange = -MINBARLEVEL * 256;
+constexpr uint32_t barScale = (100UL << 24) / barRange + 1;
+
+static uint8_t barPercent(level_t level, level_t bottom) {
+        return (uint32_t)limit(level - bottom, level_t(0), barRange) * barScale >> 24;
+}
+
+// The bars alone, like for like with the float path
+__attribute__((noinline)) static void fixedUpdate(const float * levels) {
+        level_t left = leftLevel.next(dBLevel(max(levels[1], signalFloorDB)));
+        level_t right = rightLevel.next(dBLevel(max(levels[0], signalFloorDB)));
+        if (dspMuted) {
+                sink = 0;
+                return;
+        }
+        level_t bottom = (level_t)dspVolume * 128 - barRange;
+        sink = barPercent(left, bottom) | (barPercent(right, bottom) << 8);
+}
+
+// The bars and the peak markers, as the sketch does now
+__attribute__((noinline)) static void fixedPeakUpdate(const float * levels) {
+        level_t leftInput = dBLevel(max(levels[1], signalFloorDB));    // The meters take no input below the floor
+        level_t rightInput = dBLevel(max(levels[0], signalFloorDB));
+        level_t left = leftLevel.next(leftInput);
+        level_t right = rightLevel.next(rightInput);
+        level_t lPeak = leftPeak.next(leftInput);
+        level_t rPeak = rightPeak.next(rightInput);
+        if (dspMuted) {
+                sink = 0;
+                return;
+        }
+        level_t bottom = (level_t)dspVolume * 128 - barRange;
+        sink = barPercent(left, bottom) | (barPercent(right, bottom) << 8) | (barPercent(lPeak, bottom) << 16) | (barPercent(rPeak, bottom) << 24);
+}
+
+struct Path {
+        const char * name;
+        void (*update)(const float *);
+        double ns;              // Fastest pass so far, per update
+        double ticks;
+};
+
+static Path paths[] {
+        {"float (IIR, round)", floatUpdate, 0, 0},
+        {"fixed, bars", fixedUpdate, 0, 0},
+        {"fixed, bars and peaks", fixedPeakUpdate, 0, 0}
+};
+
+// Times one pass of a path, keeping the fastest
+static void timePath(Path & path, uint32_t updates) {
+        auto start = std::chrono::steady_clock::now();
+#if HAVE_TSC
+        uint64_t ticks = __rdtsc();
+#endif
+        for (uint32_t i = 0; i < updates; i++) {
+                uint16_t n = i & (inputCount - 1);
+                path.update(inputs[n]);
+        }
+#if HAVE_TSC
+        ticks = __rdtsc() - ticks;
+#else
+        uint64_t ticks = 0;
+#endif
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / updates;
+        if (path.ns == 0 || ns < path.ns) {
+                path.ns = ns;
+                path.ticks = (double)ticks / updates;
+        }
+}
+
+int main(int argc, char ** argv) {
+        uint32_t updates = argc > 1 ? atol(argv[1]) : 10000000;
+        uint8_t passes = argc > 2 ? atoi(argv[2]) : 5;
+
+        // Music-like levels, -60 to 0 dB
+        srand(1);
+        for (uint16_t i = 0; i < inputCount; i++) {
+                inputs[i][0] = -60.0f * rand() / RAND_MAX;
+                inputs[i][1] = -60.0f * rand() / RAND_MAX;
+        }
+
+        // Passes take turns between the paths, so that a change in clock speed or load falls on all of them
+        for (uint8_t pass = 0; pass <= passes; pass++) {    // Pass 0 warms up the caches and clock
+                for (Path & path : paths) timePath(path, updates);
+                if (pass == 0) for (Path & path : paths) path.ns = 0;
+        }
+
+        printf("%-24s %11s\n", "path", "per update");
+        for (Path & path : paths) {
+                printf("%-24s %8.2f ns", path.name, path.ns);
+#if HAVE_TSC
+                printf("  %8.1f TSC ticks", path.ticks);
+#endif
+                printf("  %5.2fx\n", path.ns / paths[0].ns);
+        }
+        return 0;
+}
@@ -0,0 +1,60 @@
+// Options.h includes the filesystem headers. The replay's flash is empty and can't be written: options
+// come from the log, and saving them changes nothing.
+#pragma once
+#include <Arduino.h>
+
+namespace Adafruit_LittleFS_Namespace {
+
+enum {
+        FILE_O_READ,
+        FILE_O_WRITE
+};
+
+class HostFS {
+public:
+        bool begin() {
+                return true;
+        }
+
+        bool exists(const char *) {
+                return false;
+        }
+
+        bool mkdir(const char *) {
+                return true;
+        }
+
+        bool remove(const char *) {
+                return false;
+        }
+};
+
+class File : public Stream {
+public:
+        File(HostFS &) {
+        }
+
+        bool open(const char *, uint8_t) {
+                return false;
+        }
+
+        int read(void *, uint16_t) {
+                return 0;
+        }
+        using Stream::read;
+
+        size_t write(uint8_t) override {
+                return 0;
+        }
+
+        size_t write(const char *, size_t) {
+                return 0;
+        }
+
+        void close() {
+        }
+};
+
+}
+
+extern Adafruit_LittleFS_Namespace::HostFS InternalFS;
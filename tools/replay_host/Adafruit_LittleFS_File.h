@@ -0,0 +1,3 @@
+// Options.h includes the filesystem headers; the replay's are all in Adafruit_LittleFS.h.
+#pragma once
+#include "Adafruit_LittleFS.h"
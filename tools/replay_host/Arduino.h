@@ -0,0 +1,120 @@
+// The Arduino, nRF52 and FreeRTOS API the whole sketch uses, for replaying a stimulus log on a Linux
+// host: the uhs_host shim (time from the MAX3421E model's clock, Print, Serial) plus pins, interrupts,
+// Stream and String for the menu library, and the semaphore Standby sleeps on. Pins and interrupts are
+// the replay's (replay_host.cpp): reads return the logged inputs, writes are watched as outputs.
+
+#ifndef REPLAY_HOST_ARDUINO_H
+#define REPLAY_HOST_ARDUINO_H
+
+#include "../uhs_host/Arduino.h"
+#include <ctype.h>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define LED_RED 17
+#define AR_DEFAULT 0
+
+#define PROGMEM
+#define F(s) ((const __FlashStringHelper *)(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+template <typename T, typename L, typename H> T constrain(T x, L low, H high) {
+        return x < low ? low : x > high ? high : x;
+}
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+uint32_t analogRead(uint32_t pin);
+void analogReadResolution(int bits);
+void analogReference(uint8_t reference);
+
+inline uint32_t digitalPinToInterrupt(uint32_t pin) { return pin; }
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t mode);
+void detachInterrupt(uint32_t pin);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// FreeRTOS, as far as Standby uses it: the semaphore it sleeps on. Taking it runs the replay until
+// it's given, or the timeout.
+typedef int32_t BaseType_t;
+typedef uint32_t TickType_t;
+typedef struct HostSemaphore * SemaphoreHandle_t;
+typedef void * QueueHandle_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFF
+inline TickType_t ms2tick(uint32_t ms) { return ms; }
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t * woken);
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+class Stream : public Print {
+public:
+        virtual int available() {
+                return 0;
+        }
+
+        virtual int read() {
+                return -1;
+        }
+
+        virtual int peek() {
+                return -1;
+        }
+
+        virtual void flush() {
+        }
+
+        float parseFloat() {
+                return 0;
+        }
+};
+
+class String : public std::string {
+public:
+        String(const char *s = "") : std::string(s ? s : "") {
+        }
+
+        String(const std::string &s) : std::string(s) {
+        }
+
+        String(long n) : std::string(std::to_string(n)) {
+        }
+
+        String(double d, int digits = 2) {
+                char buf[32];
+                snprintf(buf, sizeof (buf), "%.*f", digits, d);
+                assign(buf);
+        }
+
+        String &concat(const char *s) {
+                append(s);
+                return *this;
+        }
+
+        unsigned int length() const {
+                return size();
+        }
+};
+
+#endif // REPLAY_HOST_ARDUINO_H
@@ -0,0 +1,4 @@
+// Options.h includes the filesystem headers. The replay's flash is empty and can't be written: options
+// come from the log, and saving them changes nothing.
+#pragma once
+#include "Adafruit_LittleFS.h"
@@ -0,0 +1,23 @@
+// The nRF52 quadrature decoder, as Knob uses it: read() returns the counts since the last read,
+// which the replay sets from the log's knob turns (replay_host.cpp).
+#pragma once
+#include <Arduino.h>
+
+class HwRotaryEncoder {
+public:
+        void begin(uint8_t, uint8_t) {
+        }
+
+        void start() {
+        }
+
+        int32_t read() {
+                int32_t counts = pending;
+                pending = 0;
+                return counts;
+        }
+
+        static int32_t pending;
+};
+
+extern HwRotaryEncoder RotaryEncoder;
@@ -0,0 +1,60 @@
+// The sketch starts BLE for OTA updates if the button is held at boot. The replay has no radio.
+#pragma once
+#include <Arduino.h>
+
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 0x06
+
+class BLEService {
+public:
+        void begin() {
+        }
+};
+
+class BLEDfu : public BLEService {
+};
+
+class BLEDis : public BLEService {
+public:
+        void setManufacturer(const char *) {
+        }
+
+        void setModel(const char *) {
+        }
+
+        void setFirmwareRev(const char *) {
+        }
+};
+
+class BLEAdvertising {
+public:
+        void addFlags(uint8_t) {
+        }
+
+        void addService(BLEService &) {
+        }
+
+        void restartOnDisconnect(bool) {
+        }
+
+        void setInterval(uint16_t, uint16_t) {
+        }
+
+        void setFastTimeout(uint16_t) {
+        }
+
+        void start(uint16_t) {
+        }
+};
+
+class HostBluefruit {
+public:
+        BLEAdvertising Advertising;
+
+        void begin() {
+        }
+
+        void setName(const char *) {
+        }
+};
+
+extern HostBluefruit Bluefruit;
@@ -0,0 +1,637 @@
+// Replays a stimulus log (StimulusLog.h) through the whole sketch, unmodified, in a Linux process: the
+// state machine, the remote, knob, button and trigger handling, the display and the menu, with the UHS
+// stack driving a scripted MiniDSP 2x4HD through the MAX3421E register model. Time is simulated, so
+// standby and hours of use pass in seconds. Prints the state transitions, the relay and amp enable, and
+// the settings sent to the MiniDSP, each with its time; saves them or checks them against saved ones;
+// then reports the handlers' cost on the host (the timing probes) and the power-on times.
+//
+// Build from the repository root, with U8G2 set to the src directory of the U8g2 Arduino library:
+//   gcc -c -O2 -I$U8G2/clib $U8G2/clib/*.c
+//   g++ -std=gnu++11 -O2 -fpermissive -DARDUINO=100 -DUHS_HOST_MODEL=1 -Itools/replay_host -Itools/uhs_host
+//       -Itools/display_host -Isrc/UHS -I. -I$U8G2 tools/replay_host/replay_host.cpp AmpDisplay.cpp Button.cpp
+//       InputSensing.cpp Options.cpp OptionsMenu.cpp PowerControl.cpp RemoteHandler.cpp Standby.cpp
+//       src/Menu/*.cpp src/IR/IRLib{DecodeBase,Hardware,Protocols,RecvBase,RecvPCI}.cpp
+//       src/UHS/{Usb,message,parsetools,usbhid,hidcomposite,hiduniversal,MiniDSP,usbhub,usbrecovery,usbtrace,max3421e_model}.cpp
+//       tools/uhs_host/arduino_host.cpp $U8G2/U8g2lib.cpp *.o -o replay_host
+//
+//   usage: replay_host [--write FILE | --check FILE] [--pass US] [--boot MS] [--repeat N] [--tail S] LOG
+//     LOG          the log: a serial capture holding the hex between "SLG1 BEGIN" and "SLG1 END" (sent
+//                  for 'l' on Serial), or the binary
+//     --write FILE save the outputs (transitions, relay and amps, MiniDSP settings) to FILE
+//     --check FILE compare the outputs with FILE; the first difference is shown and the exit status is 1
+//     --pass US    simulated time each pass of loop() takes, beyond the SPI and I2C transfers (default 200)
+//     --boot MS    MiniDSP boot time, from the relay closing to it appearing on the bus (default 4000)
+//     --repeat N   play the log N times, each copy a minute after the last record of the one before (default 1)
+//     --tail S     carry on for S seconds after the last record (default 10)
+//
+// The log's options are restored before setup(), and the replay boots at the log's time 0, so a log
+// whose oldest records have been dropped starts with an idle stretch. Inputs hold their last logged
+// value: trigger samples within the log's deadband, and input levels to 0.5 dB. IR frames are rebuilt
+// as pin edges (NEC and Sony) ending just before the time they were decoded, and go through the
+// receiver's interrupt handler. The MiniDSP keeps its settings across power cycles and answers level
+// requests with the log's levels. Handler costs are host CPU time: compare them with each other, not
+// with the nRF52's. Time off and asleep costs next to nothing; time on costs a loop() for each --pass,
+// so a longer pass replays on time faster, with coarser output times.
+
+#include "AmpController.ino"
+#include <stdarg.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+static UhsModel & model = UhsModel::instance();
+
+// Times (simulated) in ns
+static uint64_t msToNs(uint64_t ms) { return ms * 1000000; }
+
+// ---- Outputs: one line each, with the time
+
+static std::vector<std::string> outputs;
+
+static void output(const char * fmt, ...) __attribute__((format(printf, 1, 2)));
+static void output(const char * fmt, ...) {
+        char line[160];
+        int n = snprintf(line, sizeof (line), "%10.3f ", model.nanos() / 1e9);
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(line + n, sizeof (line) - n, fmt, ap);
+        va_end(ap);
+        puts(line);
+        outputs.push_back(line);
+}
+
+// ---- The log
+
+struct Stimulus {
+        uint64_t ns;
+        stimulus_t type;
+        uint8_t payload[6];
+};
+
+static std::vector<Stimulus> stimuli;
+static std::vector<uint8_t> optionsSnapshot;
+static bool logWrapped = false;
+
+static uint32_t le32(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t le16(const uint8_t * p) { return p[0] | p[1] << 8; }
+
+// The bytes of the log: the hex between the markers if there are any, else the file as it is
+static bool readLogBytes(const char * path, std::vector<uint8_t> & bytes) {
+        FILE * f = fopen(path, "rb");
+        if(!f)
+                return false;
+        std::string text;
+        char buf[4096];
+        size_t n;
+        while((n = fread(buf, 1, sizeof (buf), f)) > 0)
+                text.append(buf, n);
+        fclose(f);
+
+        size_t begin = text.find("SLG1 BEGIN");
+        if(begin == std::string::npos) {
+                bytes.assign(text.begin(), text.end());
+                return true;
+        }
+        size_t end = text.find("SLG1 END", begin);
+        if(end == std::string::npos)
+                end = text.size();
+        int high = -1;
+        for(size_t i = text.find('\n', begin); i < end; i++) {
+                if(!isxdigit((unsigned char)text[i]))
+                        continue;
+                int digit = isdigit((unsigned char)text[i]) ? text[i] - '0' : (toupper(text[i]) - 'A' + 10);
+                if(high < 0)
+                        high = digit;
+                else {
+                        bytes.push_back(high << 4 | digit);
+                        high = -1;
+                }
+        }
+        return true;
+}
+
+static bool readLog(const char * path, uint16_t repeat) {
+        std::vector<uint8_t> bytes;
+        if(!readLogBytes(path, bytes)) {
+                fprintf(stderr, "Can't read %s\n", path);
+                return false;
+        }
+        constexpr size_t headerSize = 13;
+        if(bytes.size() < headerSize || memcmp(bytes.data(), "SLG1", 4)) {
+                fprintf(stderr, "%s is not a stimulus log\n", path);
+                return false;
+        }
+        uint32_t time = le32(&bytes[4]);
+        uint16_t used = le16(&bytes[8]);
+        uint16_t optionsSize = le16(&bytes[10]);
+        logWrapped = bytes[12];
+        if(bytes.size() < headerSize + used + optionsSize) {
+                fprintf(stderr, "%s is cut short\n", path);
+                return false;
+        }
+        const uint8_t * p = &bytes[headerSize];
+        const uint8_t * end = p + used;
+        std::vector<Stimulus> once;
+        while(p < end) {
+                Stimulus s;
+                s.type = (stimulus_t)*p++;
+                if(s.type >= stimulus_t::Count) {
+                        fprintf(stderr, "Unknown stimulus %u in %s\n", (uint8_t)s.type, path);
+                        return false;
+                }
+                uint32_t delta = 0;
+                for(uint8_t shift = 0; p < end; shift += 7) {
+                        uint8_t b = *p++;
+                        delta |= (uint32_t)(b & 0x7F) << shift;
+                        if(!(b & 0x80))
+                                break;
+                }
+                time += delta;
+                s.ns = msToNs(time);
+                memcpy(s.payload, p, stimulusSizes[(uint8_t)s.type]);
+                p += stimulusSizes[(uint8_t)s.type];
+                once.push_back(s);
+        }
+        optionsSnapshot.assign(end, end + optionsSize);
+
+        uint64_t span = msToNs(time + 60000);
+        for(uint16_t r = 0; r < repeat; r++) {
+                for(Stimulus s : once) {
+                        s.ns += r * span;
+                        stimuli.push_back(s);
+                }
+        }
+        return true;
+}
+
+// ---- Inputs, as the sketch reads them
+
+static bool buttonLevel = HIGH;                     // Closed pulls it low
+static uint16_t triggerSamples[2] = {0, 0};
+static float inputLevels[2] = {-128, -128};       // In the MiniDSP's order: right, left
+static bool irLevel = true;                         // The receiver's output idles high
+
+struct Interrupt {
+        void (*handler)();
+        uint32_t mode;
+};
+
+static Interrupt interruptHandlers[32];
+
+void pinMode(uint32_t pin, uint32_t mode) {
+}
+
+// What the outputs were last set to, which they read back as
+static bool outputWritten[32];
+static bool outputLevels[32];
+
+int digitalRead(uint32_t pin) {
+        if(pin == ENCODER_BUTTON)
+                return buttonLevel;
+        if(pin == IR_PIN)
+                return irLevel;
+        if(pin < 32 && outputWritten[pin])
+                return outputLevels[pin];
+        return HIGH;
+}
+
+uint32_t analogRead(uint32_t pin) {
+        if(pin == ANALOG_TRIGGER_PIN)
+                return triggerSamples[0];
+        if(pin == DIGITAL_TRIGGER_PIN)
+                return triggerSamples[1];
+        return 0;
+}
+
+void analogReadResolution(int bits) {
+}
+
+void analogReference(uint8_t reference) {
+}
+
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t mode) {
+        if(pin < 32)
+                interruptHandlers[pin] = {handler, mode};
+}
+
+void detachInterrupt(uint32_t pin) {
+        if(pin < 32)
+                interruptHandlers[pin] = {nullptr, 0};
+}
+
+// Change an input pin, calling its interrupt handler as the hardware would
+static void setPin(uint32_t pin, bool & level, bool to) {
+        if(level == to)
+                return;
+        level = to;
+        const Interrupt & i = interruptHandlers[pin];
+        if(i.handler && (i.mode == CHANGE || i.mode == (to ? RISING : FALLING)))
+                i.handler();
+}
+
+// ---- IR frames, rebuilt as edges on the receiver's output
+
+struct Edge {
+        uint64_t ns;
+        bool level;
+};
+
+static std::deque<Edge> edges;
+
+// Append a frame of alternating marks (low) and spaces, starting with a mark, ending by endNs
+static void queueFrame(uint64_t endNs, const std::vector<uint32_t> & durations) {
+        uint64_t length = 0;
+        for(uint32_t d : durations)
+                length += d;
+        uint64_t t = endNs > length * 1000 ? endNs - length * 1000 : 0;
+        if(!edges.empty() && t < edges.back().ns + msToNs(20))
+                t = edges.back().ns + msToNs(20);   // After the frame before, with a gap
+        bool mark = true;
+        for(uint32_t d : durations) {
+                edges.push_back({t, !mark});
+                t += d * 1000ULL;
+                mark = !mark;
+        }
+        edges.push_back({t, true});
+}
+
+static bool queueRemote(const Stimulus & s) {
+        uint8_t protocol = s.payload[0];
+        uint8_t bits = s.payload[1];
+        uint32_t value = le32(&s.payload[2]);
+        std::vector<uint32_t> d;        // us
+        if(protocol == NEC && !bits) {
+                d = {564 * 16, 564 * 4, 564};
+        } else if(protocol == NEC) {
+                d = {564 * 16, 564 * 8};
+                for(int8_t b = bits - 1; b >= 0; b--) {
+                        d.push_back(564);
+                        d.push_back((value >> b) & 1 ? 564 * 3 : 564);
+                }
+                d.push_back(564);
+        } else if(protocol == SONY) {
+                d = {600 * 4};
+                for(int8_t b = bits - 1; b >= 0; b--) {
+                        d.push_back(600);
+                        d.push_back((value >> b) & 1 ? 600 * 2 : 600);
+                }
+        } else {
+                return false;
+        }
+        // Decoded once the receiver has seen the frame's closing gap, at the next poll
+        uint64_t lead = DEFAULT_FRAME_TIMEOUT * 1000ULL + msToNs(2);
+        queueFrame(s.ns > lead ? s.ns - lead : 0, d);
+        return true;
+}
+
+// ---- The MiniDSP: powered by the relay, on the bus bootMs later, keeping its settings across power cycles
+
+static const uint8_t devDescr[] = {
+        18, USB_DESCRIPTOR_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, 64,
+        0x52, 0x27, 0x11, 0x00, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static const uint8_t confDescr[] = {
+        9, USB_DESCRIPTOR_CONFIGURATION, 41, 0, 1, 1, 0, 0x80, 50,
+        9, USB_DESCRIPTOR_INTERFACE, 0, 0, 2, USB_CLASS_HID, 0, 0, 0,
+        9, HID_DESCRIPTOR_HID, 0x11, 0x01, 0, 1, HID_DESCRIPTOR_REPORT, 33, 0,
+        7, USB_DESCRIPTOR_ENDPOINT, 0x81, USB_TRANSFER_TYPE_INTERRUPT, 64, 0, 1,
+        7, USB_DESCRIPTOR_ENDPOINT, 0x01, USB_TRANSFER_TYPE_INTERRUPT, 64, 0, 1
+};
+
+static UhsScriptedDevice scriptedDSP(devDescr, confDescr, sizeof (confDescr));
+static constexpr uint32_t dspResponseUs = 2000;
+static uint8_t dspSettings[4] = {0, 0, 40, 0};      // FFD8.. : preset, source, volume (-0.5 dB), mute
+
+static uint64_t bootNs = msToNs(4000);
+static uint64_t dspOnNs = UINT64_MAX;               // When it appears on the bus
+static bool dspAttached = false;
+
+// Answer the commands the driver sends, in the formats MiniDSP::ParseHIDData expects
+static void dspAnswer(UhsScriptedDevice & dev, uint8_t ep, const uint8_t * buf, uint8_t len) {
+        uint8_t reply[64];
+        memset(reply, 0xff, sizeof (reply));
+
+        switch(buf[1]) {
+                case 0x14: // float read: [len][0x14][0x00][addr][floats]
+                {
+                        uint8_t n = min(buf[4], (uint8_t)15);
+                        reply[0] = 4 + 4 * n;
+                        memcpy(reply + 1, buf + 1, 3);
+                        for(uint8_t i = 0; i < n; i++) {
+                                uint8_t addr = buf[3] + i;
+                                float level = addr == 0x44 || addr == 0x45 ? inputLevels[addr - 0x44] : -128.0f;
+                                memcpy(reply + 4 + 4 * i, &level, 4);
+                        }
+                        break;
+                }
+                case 0x05: // byte read from FFD8..FFDB: [len][0x05][0xFF][addr][bytes]
+                {
+                        uint8_t n = min(buf[4], (uint8_t)8);
+                        reply[0] = 4 + n;
+                        memcpy(reply + 1, buf + 1, 3);
+                        for(uint8_t i = 0; i < n; i++) {
+                                uint8_t addr = buf[3] + i;
+                                reply[4 + i] = addr >= 0xd8 && addr <= 0xdb ? dspSettings[addr - 0xd8] : 0;
+                        }
+                        break;
+                }
+                case 0x13: // gain write: echoed
+                {
+                        float gain;
+                        memcpy(&gain, buf + 5, 4);
+                        output("dsp gain %.1f dB", gain);
+                        memcpy(reply, buf, min(len, (uint8_t)sizeof (reply)));
+                        break;
+                }
+                case 0x42: // direct sets: [0x01][cmd][value]
+                case 0x17:
+                case 0x34:
+                case 0x25:
+                {
+                        uint8_t setting = buf[1] == 0x42 ? 2 : buf[1] == 0x17 ? 3 : buf[1] == 0x34 ? 1 : 0;
+                        static const char * const names[] = {"preset", "source", "volume", "mute"};
+                        dspSettings[setting] = buf[2];
+                        output("dsp %s %u", names[setting], buf[2]);
+                        reply[0] = 0x01;
+                        reply[1] = buf[1] == 0x25 && buf[3] ? 0xab : buf[1];    // A preset set with reset answers late
+                        reply[2] = buf[2];
+                        break;
+                }
+                default:
+                        return;
+        }
+        dev.queueReport(ep, reply, sizeof (reply), dspResponseUs);
+}
+
+// ---- Outputs watched on the pins
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+        static bool relay = false;
+        static bool ampsEnabled = false;        // EN is active low, and starts high
+        if(pin < 32) {
+                outputWritten[pin] = true;
+                outputLevels[pin] = value;
+        }
+        if(pin == RELAY_PIN && relay != (bool)value) {
+                relay = value;
+                output("relay %s", relay ? "on" : "off");
+                if(relay) {
+                        dspOnNs = model.nanos() + bootNs;
+                } else {
+                        dspOnNs = UINT64_MAX;
+                        if(dspAttached)
+                                model.detach();
+                        dspAttached = false;
+                }
+        }
+        if(pin == AMP_ENABLE_PIN && ampsEnabled != !value) {
+                ampsEnabled = !value;
+                output("amps %s", ampsEnabled ? "enabled" : "disabled");
+        }
+}
+
+// ---- The rest of the board
+
+int32_t HwRotaryEncoder::pending = 0;
+HwRotaryEncoder RotaryEncoder;
+HostBluefruit Bluefruit;
+Adafruit_LittleFS_Namespace::HostFS InternalFS;
+
+// ---- Time: step the simulated clock to each input, edge or MiniDSP power-on on the way to a time
+
+static size_t nextStimulus = 0;
+static uint32_t replayed[(uint8_t)stimulus_t::Count] = {};
+
+static void apply(const Stimulus & s) {
+        replayed[(uint8_t)s.type]++;
+        switch(s.type) {
+                case stimulus_t::Remote:
+                        break;          // Queued as edges at the start
+                case stimulus_t::Knob:
+                        HwRotaryEncoder::pending += 2 * (int8_t)s.payload[0];
+                        break;
+                case stimulus_t::Button:
+                        setPin(ENCODER_BUTTON, buttonLevel, !s.payload[0]);
+                        break;
+                case stimulus_t::Triggers:
+                        triggerSamples[0] = le16(&s.payload[0]);
+                        triggerSamples[1] = le16(&s.payload[2]);
+                        break;
+                case stimulus_t::Levels:
+                        inputLevels[1] = -s.payload[0] / 2.0f;
+                        inputLevels[0] = -s.payload[1] / 2.0f;
+                        break;
+                case stimulus_t::Count:
+                        break;
+        }
+}
+
+struct HostSemaphore {
+        bool given;
+};
+
+// Advance to ns, or until the semaphore is given if there's one
+static void advanceTo(uint64_t ns, HostSemaphore * wake = nullptr) {
+        while(!wake || !wake->given) {
+                uint64_t next = ns;
+                if(nextStimulus < stimuli.size())
+                        next = min(next, stimuli[nextStimulus].ns);
+                if(!edges.empty())
+                        next = min(next, edges.front().ns);
+                next = min(next, dspOnNs);
+                if(next > model.nanos())
+                        model.advance(next - model.nanos());
+                if(next == ns)
+                        return;
+                if(nextStimulus < stimuli.size() && stimuli[nextStimulus].ns <= next) {
+                        apply(stimuli[nextStimulus++]);
+                } else if(!edges.empty() && edges.front().ns <= next) {
+                        setPin(IR_PIN, irLevel, edges.front().level);
+                        edges.pop_front();
+                } else {
+                        dspOnNs = UINT64_MAX;
+                        model.attach(&scriptedDSP);
+                        dspAttached = true;
+                }
+        }
+}
+
+// The sketch's and the stack's delays, and the display's transfers, let the inputs' interrupts in as they pass
+void delay(uint32_t ms) {
+        advanceTo(model.nanos() + msToNs(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+        advanceTo(model.nanos() + us * 1000ULL);
+}
+
+// ---- The display's bus: U8g2's Arduino callbacks, costed as the I2C transfers would be
+
+static uint32_t i2cBytes = 0;
+
+uint8_t u8x8_byte_arduino_hw_i2c(u8x8_t * u8x8, uint8_t msg, uint8_t arg_int, void * arg_ptr) {
+        if(msg == U8X8_MSG_BYTE_SEND) {
+                i2cBytes += arg_int;
+                advanceTo(model.nanos() + arg_int * 9 * 2500ULL);       // 9 bits a byte at 400 kHz
+        }
+        return 1;
+}
+
+uint8_t u8x8_gpio_and_delay_arduino(u8x8_t * u8x8, uint8_t msg, uint8_t arg_int, void * arg_ptr) {
+        switch(msg) {
+                case U8X8_MSG_DELAY_MILLI:
+                        delay(arg_int);
+                        break;
+                case U8X8_MSG_DELAY_10MICRO:
+                        delayMicroseconds(arg_int * 10);
+                        break;
+        }
+        return 1;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+        return new HostSemaphore {false};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+        advanceTo(model.nanos() + msToNs(ticks), semaphore);
+        bool given = semaphore->given;
+        semaphore->given = false;
+        return given;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t * woken) {
+        semaphore->given = true;
+        *woken = pdTRUE;
+        return pdTRUE;
+}
+
+// ---- The run
+
+static uint32_t transitionsSeen = 0;
+
+static void reportTransitions() {
+        uint32_t fresh = transitionTrace.total() - transitionsSeen;
+        for(uint32_t back = min(fresh, (uint32_t)transitionTrace.count()); back-- > 0;) {
+                const transitionRecord_t & r = transitionTrace.recent(back);
+                output("%s --%s--> %s", ampStateNames[(uint8_t)r.from], ampTriggerNames[(uint8_t)r.trigger],
+                        ampStateNames[(uint8_t)r.to]);
+        }
+        transitionsSeen = transitionTrace.total();
+}
+
+static bool saveOutputs(const char * path) {
+        FILE * f = fopen(path, "w");
+        if(!f)
+                return false;
+        for(const std::string & line : outputs)
+                fprintf(f, "%s\n", line.c_str());
+        fclose(f);
+        return true;
+}
+
+// The number of the first line that differs from the file, 0 if none
+static size_t checkOutputs(const char * path, std::string & expected) {
+        FILE * f = fopen(path, "r");
+        if(!f) {
+                expected = "(can't read the file)";
+                return 1;
+        }
+        char line[256];
+        size_t i = 0;
+        while(fgets(line, sizeof (line), f)) {
+                line[strcspn(line, "\n")] = 0;
+                if(i == outputs.size() || outputs[i] != line) {
+                        expected = line;
+                        fclose(f);
+                        return i + 1;
+                }
+                i++;
+        }
+        fclose(f);
+        expected = "(end of file)";
+        return i < outputs.size() ? i + 1 : 0;
+}
+
+int main(int argc, char ** argv) {
+        const char * logPath = nullptr;
+        const char * writePath = nullptr;
+        const char * checkPath = nullptr;
+        uint64_t passNs = 200000;
+        uint16_t repeat = 1;
+        uint64_t tailNs = msToNs(10000);
+        for(int i = 1; i < argc; i++) {
+                bool more = i + 1 < argc;
+                if(!strcmp(argv[i], "--write") && more)
+                        writePath = argv[++i];
+                else if(!strcmp(argv[i], "--check") && more)
+                        checkPath = argv[++i];
+                else if(!strcmp(argv[i], "--pass") && more)
+                        passNs = atol(argv[++i]) * 1000ULL;
+                else if(!strcmp(argv[i], "--boot") && more)
+                        bootNs = msToNs(atol(argv[++i]));
+                else if(!strcmp(argv[i], "--repeat") && more)
+                        repeat = max(atoi(argv[++i]), 1);
+                else if(!strcmp(argv[i], "--tail") && more)
+                        tailNs = msToNs(atol(argv[++i]) * 1000ULL);
+                else
+                        logPath = argv[i];
+        }
+        if(!logPath) {
+                fprintf(stderr, "usage: replay_host [--write FILE | --check FILE] [--pass US] [--boot MS] "
+                        "[--repeat N] [--tail S] LOG\n");
+                return 2;
+        }
+        if(!readLog(logPath, repeat))
+                return 2;
+        if(logWrapped)
+                printf("The log's oldest records were dropped: the replay starts part way through\n");
+        for(const Stimulus & s : stimuli)
+                if(s.type == stimulus_t::Remote && !queueRemote(s))
+                        printf("Skipping a frame in protocol %u, which can't be rebuilt\n", s.payload[0]);
+        if(!ampOptions.read(optionsSnapshot.data(), optionsSnapshot.size()))
+                printf("The log's options don't match this build's: running with the defaults\n");
+        scriptedDSP.onOut = dspAnswer;
+
+        auto wallStart = std::chrono::steady_clock::now();
+        uint64_t endNs = (stimuli.empty() ? 0 : stimuli.back().ns) + tailNs;
+        setup();
+        reportTransitions();
+        while(model.nanos() < endNs) {
+                loop();
+                reportTransitions();
+                advanceTo(model.nanos() + passNs);
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+        printf("\n%zu stimuli", stimuli.size());
+        for(uint8_t i = 0; i < (uint8_t)stimulus_t::Count; i++)
+                printf(", %s %u", stimulusNames[i], replayed[i]);
+        printf("\n%.1f s simulated in %.2f s (%.0fx), %u I2C bytes to the display\n",
+                model.nanos() / 1e9, wall, model.nanos() / 1e9 / wall, i2cBytes);
+        #if TIMING_PROBES
+        printProbes(Serial);
+        #endif
+        powerOnPlan.print(Serial);
+        Standby::instance().printStats(Serial);
+        if(model.nanos() < msToNs(UINT32_MAX / 1000))   // Its times are micros(), which wrap at 71 minutes
+                scheduler.print(Serial);
+
+        if(writePath && !saveOutputs(writePath)) {
+                fprintf(stderr, "Can't write %s\n", writePath);
+                return 2;
+        }
+        if(checkPath) {
+                std::string expected;
+                size_t line = checkOutputs(checkPath, expected);
+                if(line) {
+                        printf("Differs from %s at line %zu:\n  expected %s\n  got      %s\n", checkPath, line,
+                                expected.c_str(), line <= outputs.size() ? outputs[line - 1].c_str() : "(end)");
+                        return 1;
+                }
+                printf("Matches %s\n", checkPath);
+        }
+        return 0;
+}
@@ -0,0 +1,132 @@
+// Just enough of the Arduino API to build src/UHS on a Linux host against the
+// MAX3421E register model (UHS_HOST_MODEL). Time comes from the model's clock.
+
+#ifndef UHS_HOST_ARDUINO_H
+#define UHS_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Mixed-type like the Arduino macros, e.g. min(0, 1.5f). Returns a value: with T and U the same,
+// the conditional is an lvalue, and a reference to a parameter would dangle.
+template <typename T, typename U> auto min(T a, U b) -> typename std::decay<decltype(a < b ? a : b)>::type {
+        return a < b ? a : b;
+}
+
+template <typename T, typename U> auto max(T a, U b) -> typename std::decay<decltype(a > b ? a : b)>::type {
+        return a > b ? a : b;
+}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+class __FlashStringHelper;
+
+class Print {
+public:
+        virtual ~Print() {
+        }
+        virtual size_t write(uint8_t c) = 0;
+
+        size_t write(const uint8_t *buf, size_t n) {
+                for(size_t i = 0; i < n; i++)
+                        write(buf[i]);
+                return n;
+        }
+
+        size_t write(const char *str) {
+                return write((const uint8_t *)str, strlen(str));
+        }
+
+        size_t print(const char *str) {
+                return write(str);
+        }
+
+        size_t print(const __FlashStringHelper *str) {
+                return write((const char *)str);
+        }
+
+        size_t print(char c) {
+                return write((uint8_t)c);
+        }
+
+        size_t print(unsigned long n, int base = DEC);
+
+        size_t print(long n, int base = DEC) {
+                if(base == DEC && n < 0)
+                        return write((uint8_t)'-') + print((unsigned long)-n, base);
+                return print((unsigned long)n, base);
+        }
+
+        size_t print(unsigned int n, int base = DEC) {
+                return print((unsigned long)n, base);
+        }
+
+        size_t print(int n, int base = DEC) {
+                return print((long)n, base);
+        }
+
+        size_t print(unsigned char n, int base = DEC) {
+                return print((unsigned long)n, base);
+        }
+
+        size_t print(double d, int digits = 2);
+
+        size_t println() {
+                return write("\r\n");
+        }
+
+        template <typename T> size_t println(T v) {
+                return print(v) + println();
+        }
+
+        template <typename T> size_t println(T v, int fmt) {
+                return print(v, fmt) + println();
+        }
+
+        size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HostSerial : public Print {
+public:
+        void begin(unsigned long) {
+        }
+
+        size_t write(uint8_t c) override {
+                putchar(c);
+                return 1;
+        }
+        using Print::write;
+
+        int available() {
+                return 0;
+        }
+
+        int read() {
+                return -1;
+        }
+
+        void flush() {
+                fflush(stdout);
+        }
+
+        operator bool() const {
+                return true;
+        }
+};
+
+extern HostSerial Serial;
+
+#endif // UHS_HOST_ARDUINO_H
@@ -0,0 +1,58 @@
+// Arduino API for the host build, with time taken from the MAX3421E model's
+// clock so that delays and busy-waits in the stack advance simulated time.
+
+#include <stdarg.h>
+#include "Usb.h"
+
+HostSerial Serial;
+
+uint32_t millis() {
+        return UhsModel::instance().millis();
+}
+
+uint32_t micros() {
+        return UhsModel::instance().micros();
+}
+
+// Weak, so that a runner with inputs to deliver as time passes can replace them
+__attribute__((weak)) void delay(uint32_t ms) {
+        UhsModel::instance().advance((uint64_t)ms * 1000000);
+}
+
+__attribute__((weak)) void delayMicroseconds(uint32_t us) {
+        UhsModel::instance().advance((uint64_t)us * 1000);
+}
+
+void yield() {
+}
+
+size_t Print::print(unsigned long n, int base) {
+        char buf[8 * sizeof (long) + 1];
+        char *p = &buf[sizeof (buf) - 1];
+        *p = '\0';
+        if(base < 2)
+                base = 10;
+        do {
+                unsigned long d = n % base;
+                *--p = d < 10 ? '0' + d : 'A' + d - 10;
+                n /= base;
+        } while(n);
+        return write(p);
+}
+
+size_t Print::print(double d, int digits) {
+        char buf[48];
+        snprintf(buf, sizeof (buf), "%.*f", digits, d);
+        return write(buf);
+}
+
+size_t Print::printf(const char *fmt, ...) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof (buf), fmt, ap);
+        va_end(ap);
+        if(n < 0)
+                return 0;
+        return write(buf);
+}
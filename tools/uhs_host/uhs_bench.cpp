@@ -0,0 +1,238 @@
+// Runs the UHS stack and the MiniDSP driver unmodified in a Linux process,
+// against the MAX3421E register model and scripted MiniDSP 2x4HDs, and
+// reports enumeration time, request-to-callback latency, per-poll cost and
+// the time a volume change takes to be acknowledged by every unit.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -DARDUINO=100 -DUHS_HOST_MODEL=1 -Itools/uhs_host -Isrc/UHS
+//       tools/uhs_host/*.cpp src/UHS/{Usb,message,parsetools,usbhid,hidcomposite,hiduniversal,usbhub,MiniDSP,usbtrace,max3421e_model}.cpp
+//       -o uhs_bench
+//
+//   usage: uhs_bench [requests [response_us [loop_us [units [interval]]]]]
+//     requests     input level requests and volume changes to time (default 1000)
+//     response_us  MiniDSP time to answer a request (default 2000)
+//     loop_us      time the rest of the main loop takes between USB polls (default 100)
+//     units        MiniDSPs (default 1); more than one are put behind a hub
+//     interval     bInterval (ms) of the MiniDSP's interrupt-IN endpoint (default 1, as on
+//                  the real unit). HIDUniversal polls every 1 ms while it expects a response,
+//                  so only a longer bInterval shows that in the latency.
+//
+// All times are simulated: SPI and bus costs come from UhsModel::Timing.
+
+#include "Usb.h"
+#include "usbhub.h"
+#include "MiniDSP.h"
+
+static const uint8_t devDescr[] = {
+        18, USB_DESCRIPTOR_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, 64,
+        0x52, 0x27, 0x11, 0x00, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static uint8_t confDescr[] = {       // Not const: the bench can change the IN endpoint's bInterval
+        9, USB_DESCRIPTOR_CONFIGURATION, 41, 0, 1, 1, 0, 0x80, 50,
+        9, USB_DESCRIPTOR_INTERFACE, 0, 0, 2, USB_CLASS_HID, 0, 0, 0,
+        9, HID_DESCRIPTOR_HID, 0x11, 0x01, 0, 1, HID_DESCRIPTOR_REPORT, 33, 0,
+        7, USB_DESCRIPTOR_ENDPOINT, 0x81, USB_TRANSFER_TYPE_INTERRUPT, 64, 0, 1,
+        7, USB_DESCRIPTOR_ENDPOINT, 0x01, USB_TRANSFER_TYPE_INTERRUPT, 64, 0, 1
+};
+static const uint8_t inIntervalOffset = 9 + 9 + 9 + 6;
+
+static uint32_t responseUs = 2000;
+static uint8_t dspVolume = 40;
+static uint8_t dspMute = 0;
+static uint8_t dspSource = 0;
+
+// Answer the commands the driver sends, in the formats MiniDSP::ParseHIDData expects
+static void dspCommand(UhsScriptedDevice &dev, uint8_t ep, const uint8_t *buf, uint8_t len __attribute__((unused))) {
+        uint8_t reply[64];
+        memset(reply, 0xff, sizeof (reply));
+
+        switch(buf[1]) {
+                case 0x14: // float read: [len][0x14][0x00][addr][floats]
+                {
+                        uint8_t n = buf[4];
+                        reply[0] = 4 + 4 * n;
+                        memcpy(reply + 1, buf + 1, 3);
+                        for(uint8_t i = 0; i < n; i++) {
+                                float level = -20.0f - i;
+                                memcpy(reply + 4 + 4 * i, &level, 4);
+                        }
+                        break;
+                }
+                case 0x05: // byte read from FFD8..FFDB: [len][0x05][0xFF][addr][bytes]
+                {
+                        uint8_t n = buf[4];
+                        reply[0] = 4 + n;
+                        memcpy(reply + 1, buf + 1, 3);
+                        for(uint8_t i = 0; i < n; i++) {
+                                uint8_t addr = buf[3] + i;
+                                reply[4 + i] = addr == 0xd9 ? dspSource : addr == 0xda ? dspVolume : addr == 0xdb ? dspMute : 0;
+                        }
+                        break;
+                }
+                case 0x42: // direct set: [0x01][cmd][value]
+                        dspVolume = buf[2];
+                        reply[0] = 0x01;
+                        reply[1] = buf[1];
+                        reply[2] = buf[2];
+                        break;
+                case 0x17:
+                        dspMute = buf[2];
+                        reply[0] = 0x01;
+                        reply[1] = buf[1];
+                        reply[2] = buf[2];
+                        break;
+                case 0x34:
+                        dspSource = buf[2];
+                        reply[0] = 0x01;
+                        reply[1] = buf[1];
+                        reply[2] = buf[2];
+                        break;
+                default:
+                        return;
+        }
+        dev.queueReport(ep, reply, sizeof (reply), responseUs);
+}
+
+static USB thisUSB;
+static bool levelsReceived = false;
+
+static void onInputLevels(float *) {
+        levelsReceived = true;
+}
+
+static uint64_t loopNs;
+
+static void loopOnce() {
+        thisUSB.Task();
+        UhsModel::instance().advance(loopNs);
+}
+
+int main(int argc, char **argv) {
+        uint32_t requests = argc > 1 ? atol(argv[1]) : 1000;
+        responseUs = argc > 2 ? atol(argv[2]) : 2000;
+        loopNs = (argc > 3 ? atol(argv[3]) : 100) * 1000ULL;
+        uint8_t units = argc > 4 ? atoi(argv[4]) : 1;
+        if(units < 1 || units > MiniDSPGroup::maxUnits) {
+                printf("units must be 1 to %u\n", MiniDSPGroup::maxUnits);
+                return 1;
+        }
+        uint8_t interval = argc > 5 ? atoi(argv[5]) : 1;
+        if(interval < 1) {
+                printf("interval must be at least 1 ms\n");
+                return 1;
+        }
+        confDescr[inIntervalOffset] = interval;
+
+        // Drivers register with thisUSB, so only create what this run uses
+        UhsModel &model = UhsModel::instance();
+        UhsModelHub scriptedHub;
+        UhsScriptedDevice *scriptedDSP[MiniDSPGroup::maxUnits];
+        MiniDSP *dsps[MiniDSPGroup::maxUnits];
+        if(units > 1)
+                new USBHub(&thisUSB);
+        for(uint8_t i = 0; i < units; i++) {
+                scriptedDSP[i] = new UhsScriptedDevice(devDescr, confDescr, sizeof (confDescr));
+                scriptedDSP[i]->onOut = dspCommand;
+                dsps[i] = new MiniDSP(&thisUSB);
+        }
+        MiniDSPGroup group(dsps[0]);
+        for(uint8_t i = 1; i < units; i++)
+                group.add(dsps[i]);
+        MiniDSP &dsp = group.primary();
+        dsp.attachOnNewInputLevels(onInputLevels);
+
+        if(thisUSB.Init() == -1) {
+                printf("MAX3421E model did not start\n");
+                return 1;
+        }
+
+        // Enumeration, from plug-in until every unit is connected
+        if(units > 1) {
+                for(uint8_t i = 0; i < units; i++)
+                        scriptedHub.plug(i + 1, scriptedDSP[i]);
+                model.attach(&scriptedHub);
+        } else
+                model.attach(scriptedDSP[0]);
+        uint64_t t0 = model.nanos();
+        while(!group.connected() && model.nanos() - t0 < 10000000000ULL)
+                loopOnce();
+        if(!group.connected()) {
+                printf("MiniDSPs did not enumerate (task state 0x%02x)\n", thisUSB.getUsbTaskState());
+                return 1;
+        }
+        printf("enumeration       %8.3f ms, %u transfers, %u SPI accesses\n",
+                (model.nanos() - t0) / 1e6, model.stats.transfers, model.stats.spiAccesses);
+
+        // Idle polling: nothing outstanding, so every interrupt-IN poll NAKs
+        model.resetStats();
+        dsp.ResetPollStats();
+        uint32_t idleLoops = 0;
+        t0 = model.nanos();
+        while(model.nanos() - t0 < 1000000000ULL) {
+                loopOnce();
+                idleLoops++;
+        }
+        printf("idle, 1 s         %8u loops, %u IN polls, %.2f us SPI per loop, %.1f%% of CPU on SPI\n",
+                idleLoops, dsp.GetPollStats().polls, model.stats.spiNs / 1e3 / idleLoops,
+                100.0 * model.stats.spiNs / (model.nanos() - t0));
+
+        // Request/response: time from RequestInputLevels() to the levels callback
+        model.resetStats();
+        dsp.ResetPollStats();
+        uint64_t total = 0, worst = 0, best = ~0ULL;
+        uint32_t lost = 0;
+        for(uint32_t i = 0; i < requests; i++) {
+                levelsReceived = false;
+                uint64_t start = model.nanos();
+                dsp.RequestInputLevels();
+                while(!levelsReceived && model.nanos() - start < 100000000ULL)
+                        loopOnce();
+                if(!levelsReceived) {
+                        lost++;
+                        continue;
+                }
+                uint64_t latency = model.nanos() - start;
+                total += latency;
+                worst = latency > worst ? latency : worst;
+                best = latency < best ? latency : best;
+        }
+        uint32_t answered = requests - lost;
+        const HIDUniversal::PollStats &ps = dsp.GetPollStats();
+        printf("requests          %8u sent, %u answered\n", requests, answered);
+        if(answered)
+                printf("latency           %8.3f ms mean, %.3f min, %.3f max (device answers after %.3f ms)\n",
+                        total / 1e6 / answered, best / 1e6, worst / 1e6, responseUs / 1e3);
+        printf("IN polls          %8u, %u reports, %u NAKs, %u errors, %u timeouts\n",
+                ps.polls, ps.reports, ps.naks, ps.errors, ps.timeouts);
+        if(requests)
+                printf("per request       %8.2f SPI accesses, %.2f us SPI, %.2f us bus\n",
+                        (double)model.stats.spiAccesses / requests, model.stats.spiNs / 1e3 / requests,
+                        model.stats.busNs / 1e3 / requests);
+
+        // Volume fan-out: time from setVolume() on the group until every unit has acknowledged
+        model.resetStats();
+        total = worst = 0;
+        best = ~0ULL;
+        uint32_t unacked = 0;
+        for(uint32_t i = 0; i < requests; i++) {
+                uint64_t start = model.nanos();
+                group.setVolume(20 + (i & 1));
+                while(!group.acknowledged() && model.nanos() - start < 100000000ULL)
+                        loopOnce();
+                if(!group.acknowledged()) {
+                        unacked++;
+                        continue;
+                }
+                uint64_t latency = model.nanos() - start;
+                total += latency;
+                worst = latency > worst ? latency : worst;
+                best = latency < best ? latency : best;
+        }
+        uint32_t acked = requests - unacked;
+        printf("volume            %8u sent to %u unit%s, %u acknowledged by all\n", requests, units, units > 1 ? "s" : "", acked);
+        if(acked)
+                printf("volume latency    %8.3f ms mean, %.3f min, %.3f max\n",
+                        total / 1e6 / acked, best / 1e6, worst / 1e6);
+        return (lost || unacked) ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Decode a USB Host Shield event trace (see src/UHS/usbtrace.h) into a timeline.
+
+Accepts either the binary dump written to LittleFS (/usbtrace.bin) or a serial
+console capture containing a hex dump between "UHT1 BEGIN" and "UHT1 END".
+
+    usage: usbtrace_decode.py [--raw] FILE
+"""
+
+import struct
+import sys
+
+# Keep in step with UsbTraceCode in src/UHS/usbtrace.h
+EVENTS = {
+    1: "VBUS",
+    2: "TASK_STATE",
+    3: "CTRL_REQ",
+    4: "CTRL_VALUE",
+    5: "SETADDR_FAIL",
+    6: "IN_XFER",
+    7: "IN_DONE",
+    8: "DISPATCH",
+    9: "CONF_SIZE",
+    10: "HID_SETIDLE",
+    11: "HID_POLL",
+    12: "RECOVERY",
+}
+
+# USBRecovery::step_t from src/UHS/usbrecovery.h
+RECOVERY_STEPS = {0: "Watch", 1: "BusReset", 2: "ChipReset", 3: "VbusToggle", 4: "PowerCycle"}
+
+# From UsbCore.h and max3421e.h
+TASK_STATES = {
+    0x11: "DETACHED_INITIALIZE",
+    0x12: "DETACHED_WAIT_FOR_DEVICE",
+    0x13: "DETACHED_ILLEGAL",
+    0x20: "ATTACHED_SETTLE",
+    0x30: "ATTACHED_RESET_DEVICE",
+    0x40: "ATTACHED_WAIT_RESET_COMPLETE",
+    0x50: "ATTACHED_WAIT_SOF",
+    0x51: "ATTACHED_WAIT_RESET",
+    0x60: "ATTACHED_GET_DEVICE_DESCRIPTOR_SIZE",
+    0x70: "ADDRESSING",
+    0x80: "CONFIGURING",
+    0x90: "RUNNING",
+    0xa0: "ERROR",
+}
+VBUS_STATES = {0: "SE0", 1: "SE1", 2: "FSHOST", 3: "LSHOST"}
+
+# Host result codes (HRSL) from max3421e.h
+RCODES = {
+    0x00: "OK", 0x01: "BUSY", 0x02: "BADREQ", 0x03: "UNDEF", 0x04: "NAK",
+    0x05: "STALL", 0x06: "TOGERR", 0x07: "WRONGPID", 0x08: "BADBC",
+    0x09: "PIDERR", 0x0a: "PKTERR", 0x0b: "CRCERR", 0x0c: "KERR",
+    0x0d: "JERR", 0x0e: "TIMEOUT", 0x0f: "BABBLE",
+}
+
+RECORD = struct.Struct("<IBBH")
+HEADER = struct.Struct("<4sHH")
+
+
+def state(s):
+    return TASK_STATES.get(s, "0x%02x" % s)
+
+
+def rcode(r):
+    return RCODES.get(r, "0x%02x" % r)
+
+
+def describe(code, a1, a2):
+    if code == 1:
+        return "%s (task %s)" % (VBUS_STATES.get(a1, a1), state(a2))
+    if code == 2:
+        return "%s <- %s" % (state(a1), state(a2 & 0xff))
+    if code == 3:
+        return "addr %d ep %d bmReqType 0x%02x bRequest 0x%02x" % (a1 >> 4, a1 & 0x0f, a2 >> 8, a2 & 0xff)
+    if code == 4:
+        return "wValHi 0x%02x total %d" % (a1, a2)
+    if code == 5:
+        return "%s addr %d ep %d" % (rcode(a1), a2 >> 8, a2 & 0xff)
+    if code == 6:
+        return "ep %d want %d" % (a1, a2)
+    if code == 7:
+        return "%s got %d" % (rcode(a1), a2)
+    if code == 8:
+        return "token 0x%02x ep %d nak_limit %d" % (a1 & 0xf0, a1 & 0x0f, a2)
+    if code == 9:
+        return "conf %d total %d" % (a1, a2)
+    if code == 10:
+        return "iface %d %s" % (a1, rcode(a2))
+    if code == 11:
+        return "iface %d %s read %d" % (a1, rcode(a2 >> 8), a2 & 0xff)
+    if code == 12:
+        return "%s after %d ms" % (RECOVERY_STEPS.get(a1, a1), a2 * 10)
+    return "arg1 0x%02x arg2 0x%04x" % (a1, a2)
+
+
+def load(path):
+    data = open(path, "rb").read()
+    if not data.startswith(b"UHT1"):
+        # Serial capture: pull the hex lines out from between the markers
+        text = data.decode("ascii", "replace").splitlines()
+        try:
+            start = max(i for i, l in enumerate(text) if l.strip() == "UHT1 BEGIN")
+        except ValueError:
+            sys.exit("%s: no trace found" % path)
+        lines = []
+        for l in text[start + 1:]:
+            if l.strip() == "UHT1 END":
+                break
+            lines.append(l.strip())
+        data = bytes.fromhex("".join(lines))
+    magic, count, dropped = HEADER.unpack_from(data, 0)
+    if magic != b"UHT1":
+        sys.exit("%s: bad trace header" % path)
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+               for i in range(count)
+               if HEADER.size + (i + 1) * RECORD.size <= len(data)]
+    return records, dropped
+
+
+def main(argv):
+    raw = "--raw" in argv
+    args = [a for a in argv if a != "--raw"]
+    if len(args) != 1:
+        sys.exit(__doc__)
+    records, dropped = load(args[0])
+    if dropped:
+        print("# %d older records were overwritten" % dropped)
+    if not records:
+        return
+    t0 = prev = records[0][0]
+    for t, code, a1, a2 in records:
+        # micros() wraps every ~71 minutes; the unsigned deltas survive that
+        rel = (t - t0) & 0xffffffff
+        step = (t - prev) & 0xffffffff
+        prev = t
+        name = EVENTS.get(code, "USER_%d" % code)
+        detail = "arg1 0x%02x arg2 0x%04x" % (a1, a2) if raw else describe(code, a1, a2)
+        print("%12.3f ms %+10.3f  %-13s %s" % (rel / 1000.0, step / 1000.0, name, detail))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
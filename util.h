@@ -7,6 +7,13 @@ inline uint8_t contrast(uint8_t brightness) {
     return (uint8_t)(val & 0xFF);
 }
 
+// OLED contrast from brightness in 1/256ths, stepping between the levels of contrast(), for fades
+inline uint8_t fadeContrast(uint16_t brightness) {
+    uint8_t whole = brightness >> 8;
+    if (whole >= 8) return 0xFF;
+    return contrast(whole) + (((1 << whole) * (brightness & 0xFF)) >> 8);
+}
+
 // Constrain between low and high limits
 template<class T> 
 inline T limit(const T& value, const T& min, const T& max) { 